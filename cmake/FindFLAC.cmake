@@ -0,0 +1,20 @@
+# Variables defined:
+#  FLAC_FOUND
+#  FLAC_INCLUDE_DIR
+#  FLAC_LIBRARY
+# 
+# Environment variables used:
+#  FLAC_ROOT
+
+find_path(FLAC_INCLUDE_DIR FLAC/stream_decoder.h)
+find_path(FLAC_INCLUDE_DIR FLAC/stream_decoder.h
+	HINTS $ENV{FLAC_ROOT}/include)
+
+find_library(FLAC_LIBRARY NAMES FLAC libFLAC)
+find_library(FLAC_LIBRARY NAMES FLAC libFLAC
+    HINTS $ENV{FLAC_ROOT})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(FLAC DEFAULT_MSG FLAC_LIBRARY FLAC_INCLUDE_DIR)
+
+mark_as_advanced(FLAC_LIBRARY FLAC_INCLUDE_DIR)
@@ -0,0 +1,30 @@
+# Variables defined:
+#  OPUSFILE_FOUND
+#  OPUSFILE_INCLUDE_DIR
+#  OPUSFILE_LIBRARY
+#  OPUS_LIBRARY
+# 
+# Environment variables used:
+#  OPUSFILE_ROOT
+
+# opusfile.h includes <opus_multistream.h> directly so the opus include dir is needed as well.
+find_path(OPUSFILE_INCLUDE_DIR opus/opusfile.h)
+find_path(OPUSFILE_INCLUDE_DIR opus/opusfile.h
+	HINTS $ENV{OPUSFILE_ROOT}/include)
+
+find_path(OPUS_INCLUDE_DIR opus_multistream.h
+    PATH_SUFFIXES opus
+    HINTS $ENV{OPUSFILE_ROOT}/include)
+
+find_library(OPUSFILE_LIBRARY NAMES opusfile)
+find_library(OPUSFILE_LIBRARY NAMES opusfile
+    HINTS $ENV{OPUSFILE_ROOT})
+
+find_library(OPUS_LIBRARY NAMES opus)
+find_library(OPUS_LIBRARY NAMES opus
+    HINTS $ENV{OPUSFILE_ROOT})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(OPUSFILE DEFAULT_MSG OPUSFILE_LIBRARY OPUS_LIBRARY OPUSFILE_INCLUDE_DIR OPUS_INCLUDE_DIR)
+
+mark_as_advanced(OPUSFILE_LIBRARY OPUS_LIBRARY OPUSFILE_INCLUDE_DIR OPUS_INCLUDE_DIR)
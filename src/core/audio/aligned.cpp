@@ -0,0 +1,51 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include "config.hpp"
+
+#include <new>
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(PLATFORM_WINDOWS)
+#   include <malloc.h>
+#endif
+
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    void AlignedDeleter::operator()(float* ptr) const
+    {
+#if defined(PLATFORM_WINDOWS)
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+
+    AlignedFloats make_aligned_floats(size_t count)
+    {
+        // Round up to a multiple of the alignment so SIMD loops can safely overrun the end.
+        size_t bytes = ((count * sizeof(float)) + audioAlignment - 1) & ~(audioAlignment - 1);
+        bytes = std::max(bytes, audioAlignment);
+
+        void* memory = nullptr;
+#if defined(PLATFORM_WINDOWS)
+        memory = _aligned_malloc(bytes, audioAlignment);
+#else
+        if (posix_memalign(&memory, audioAlignment, bytes) != 0)
+        {
+            memory = nullptr;
+        }
+#endif
+        if (memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        float* floats = static_cast<float*>(memory);
+        std::fill(floats, floats + (bytes / sizeof(float)), 0.0f);
+        return AlignedFloats(floats);
+    }
+}
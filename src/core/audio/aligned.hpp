@@ -0,0 +1,23 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <memory>
+#include <cstddef>
+
+namespace ORCore
+{
+    // Alignment used for all audio scratch memory, enough for AVX and a full cache line.
+    const size_t audioAlignment = 64;
+
+    struct AlignedDeleter
+    {
+        void operator()(float* ptr) const;
+    };
+
+    using AlignedFloats = std::unique_ptr<float[], AlignedDeleter>;
+
+    // Allocates zeroed float storage aligned to `audioAlignment`.
+    // This allocates from the heap so it should never be called from the audio thread.
+    AlignedFloats make_aligned_floats(size_t count);
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <chrono>
+#include <algorithm>
+
+#include "audioclock.hpp"
+
+namespace ORCore
+{
+    AudioClock::AudioClock()
+    : m_sequence(0),
+    m_frames(0),
+    m_deviceFrames(0),
+    m_blockFrames(0),
+    m_timestamp(0.0),
+    m_playing(false),
+    m_sampleRate(44100),
+    m_latency(0.0),
+    m_lastFramesPlayed(0.0)
+    {
+    }
+
+    void AudioClock::publish(const ClockSnapshot& snapshot)
+    {
+        uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+
+        // An odd sequence tells readers an update is in progress.
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        m_frames.store(snapshot.frames, std::memory_order_relaxed);
+        m_deviceFrames.store(snapshot.deviceFrames, std::memory_order_relaxed);
+        m_blockFrames.store(snapshot.blockFrames, std::memory_order_relaxed);
+        m_timestamp.store(snapshot.timestamp, std::memory_order_relaxed);
+        m_playing.store(snapshot.playing, std::memory_order_relaxed);
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    ClockSnapshot AudioClock::read()
+    {
+        ClockSnapshot snapshot;
+        uint32_t before, after;
+        do
+        {
+            before = m_sequence.load(std::memory_order_acquire);
+
+            snapshot.frames = m_frames.load(std::memory_order_relaxed);
+            snapshot.deviceFrames = m_deviceFrames.load(std::memory_order_relaxed);
+            snapshot.blockFrames = m_blockFrames.load(std::memory_order_relaxed);
+            snapshot.timestamp = m_timestamp.load(std::memory_order_relaxed);
+            snapshot.playing = m_playing.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        }
+        while ((before & 1) != 0 || before != after);
+
+        return snapshot;
+    }
+
+    void AudioClock::set_sample_rate(int sampleRate)
+    {
+        m_sampleRate.store(sampleRate, std::memory_order_relaxed);
+    }
+
+    int AudioClock::get_sample_rate()
+    {
+        return m_sampleRate.load(std::memory_order_relaxed);
+    }
+
+    void AudioClock::set_latency(double frames)
+    {
+        m_latency.store(std::max(0.0, frames), std::memory_order_relaxed);
+    }
+
+    double AudioClock::get_latency()
+    {
+        return m_latency.load(std::memory_order_relaxed);
+    }
+
+    double AudioClock::get_frames_played()
+    {
+        ClockSnapshot snapshot = read();
+        if (snapshot.frames == 0)
+        {
+            return m_lastFramesPlayed;
+        }
+
+        // While the source is paused the device drains what was already written so everything ends up heard.
+        double played = snapshot.frames;
+        if (snapshot.playing)
+        {
+            double elapsed = now() - snapshot.timestamp;
+            played = (snapshot.frames - get_latency()) + (elapsed * get_sample_rate());
+
+            // Nothing past the last written frame can be heard, this also stops the clock when the writer stops.
+            played = std::min(played, static_cast<double>(snapshot.frames));
+        }
+
+        // Jitter in callback timing or latency updates must not make the clock go backwards.
+        m_lastFramesPlayed = std::max(m_lastFramesPlayed, played);
+        return m_lastFramesPlayed;
+    }
+
+    double AudioClock::get_time()
+    {
+        return get_frames_played() / get_sample_rate();
+    }
+
+    double AudioClock::now()
+    {
+        using Seconds = std::chrono::duration<double>;
+        return std::chrono::duration_cast<Seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
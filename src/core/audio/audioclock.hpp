@@ -0,0 +1,72 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace ORCore
+{
+    struct ClockSnapshot
+    {
+        // Source frames handed to the device including the last block, these stop while the source is paused.
+        int64_t frames;
+
+        // Every frame handed to the device, silence included.
+        int64_t deviceFrames;
+        int blockFrames;
+
+        // When the last block was handed over, in AudioClock::now() seconds.
+        double timestamp;
+
+        // False if the last block was silence because the source was paused.
+        bool playing;
+    };
+
+    // Playback clock driven by the audio thread.
+    // The audio thread publishes how many frames it has written with a seqlock so it never waits on readers,
+    // readers interpolate between updates with a high resolution timer and subtract the output latency
+    // to get the frame that is currently being heard.
+    class AudioClock
+    {
+    public:
+        AudioClock();
+
+        // Only ever called by the single writer thread.
+        void publish(const ClockSnapshot& snapshot);
+
+        // Returns the most recent consistent snapshot.
+        ClockSnapshot read();
+
+        void set_sample_rate(int sampleRate);
+        int get_sample_rate();
+
+        // Frames between being written and being heard, including the block being written.
+        void set_latency(double frames);
+        double get_latency();
+
+        // Frame currently being heard, never goes backwards.
+        // Keeps state for that so it must only be used from a single reader thread.
+        double get_frames_played();
+
+        // get_frames_played in seconds.
+        double get_time();
+
+        // Seconds from a monotonic high resolution clock.
+        static double now();
+
+    private:
+        std::atomic<uint32_t> m_sequence;
+        std::atomic<int64_t> m_frames;
+        std::atomic<int64_t> m_deviceFrames;
+        std::atomic<int> m_blockFrames;
+        std::atomic<double> m_timestamp;
+        std::atomic_bool m_playing;
+
+        std::atomic<int> m_sampleRate;
+        std::atomic<double> m_latency;
+
+        // Only used by the reader thread.
+        double m_lastFramesPlayed;
+    };
+}
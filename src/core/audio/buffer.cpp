@@ -1,68 +1,110 @@
 // Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
 // See LICENSE in the project root for license information.
 
+#include <stdexcept>
+
 #include "buffer.hpp"
 
 namespace ORCore
 {
     Buffer::Buffer()
-    :m_allocated(false), m_info({0,0}), m_size(0)
+    :m_buffer(nullptr), m_pool(nullptr), m_info({0,0}), m_size(0)
     {
     }
 
     Buffer::Buffer(BufferInfo info)
-    :m_allocated(true), m_info(info), m_size(info.channels * info.frames)
+    :Buffer(info, get_buffer_pool())
+    {
+    }
+
+    Buffer::Buffer(BufferInfo info, BufferPool& pool)
+    :m_buffer(nullptr), m_pool(nullptr), m_info(info), m_size(info.channels * info.frames)
     {
-        m_buffer = new float[m_size];
+        acquire(pool, m_size);
     }
 
     Buffer::Buffer(float* buffer, BufferInfo info)
-    :m_allocated(false), m_info(info), m_size(info.channels * info.frames)
+    :m_buffer(buffer), m_pool(nullptr), m_info(info), m_size(info.channels * info.frames)
     {
-        m_buffer = buffer;
     }
 
     Buffer::Buffer(const Buffer& other)
-    :m_allocated(true), m_info(other.m_info), m_size(other.m_size)
+    :m_buffer(nullptr), m_pool(nullptr), m_info(other.m_info), m_size(other.m_size)
     {
-        m_buffer = new float[m_size];
+        acquire(other.m_pool != nullptr ? *other.m_pool : get_buffer_pool(), m_size);
         std::copy(other.m_buffer, other.m_buffer + other.m_size, m_buffer);
     }
 
     Buffer::Buffer(Buffer&& other)
-    :m_allocated(other.m_allocated), m_info(other.m_info), m_size(other.m_size)
+    :m_buffer(other.m_buffer), m_pool(other.m_pool), m_info(other.m_info), m_size(other.m_size)
     {
-        m_buffer = other.m_buffer;
         other.m_buffer = nullptr;
-        other.m_allocated = false;
+        other.m_pool = nullptr;
         other.m_info = {0, 0};
         other.m_size = 0;
     }
 
     Buffer::~Buffer()
     {
-        if (m_allocated)
+        release();
+    }
+
+    void Buffer::acquire(BufferPool& pool, int size)
+    {
+        // Empty buffers don't need any memory.
+        if (size <= 0)
+        {
+            return;
+        }
+
+        if (static_cast<size_t>(size) > pool.get_block_capacity())
+        {
+            throw std::runtime_error("Buffer: Larger than a pool block.");
+        }
+
+        m_buffer = pool.acquire();
+        if (m_buffer == nullptr)
+        {
+            throw std::runtime_error("Buffer: Pool is empty.");
+        }
+        m_pool = &pool;
+    }
+
+    void Buffer::release()
+    {
+        if (m_pool != nullptr)
         {
-            delete[] m_buffer;
+            m_pool->release(m_buffer);
+            m_pool = nullptr;
         }
+        m_buffer = nullptr;
+    }
+
+    // Make sure there is room for other's samples, sized from other rather than the current size.
+    void Buffer::reserve(const Buffer& other)
+    {
+        // Views of the same size keep writing into the memory they view.
+        if (m_size == other.m_size && m_buffer != nullptr)
+        {
+            return;
+        }
+
+        // An owned block can hold anything up to its capacity.
+        if (m_pool != nullptr && static_cast<size_t>(other.m_size) <= m_pool->get_block_capacity())
+        {
+            return;
+        }
+
+        BufferPool* pool = m_pool != nullptr ? m_pool : other.m_pool;
+        release();
+        acquire(pool != nullptr ? *pool : get_buffer_pool(), other.m_size);
     }
 
     Buffer& Buffer::operator=(const Buffer& other)
     {
         if (this != &other)
         {
-            if (m_size != other.m_size)
-            {
-                // If we previously allocated and the new buffer size is different
-                // free the old memory
-                if (m_allocated)
-                {
-                    delete[] m_buffer;
-                }
-                m_buffer = new float[m_size];
-                m_allocated = true;
-
-            }
+            reserve(other);
             std::copy(other.m_buffer, other.m_buffer + other.m_size, m_buffer);
 
             m_info = other.m_info;
@@ -75,19 +117,20 @@ namespace ORCore
     {
         if (this != &other)
         {
+            release();
+
             m_buffer = other.m_buffer;
-            m_allocated = other.m_allocated;
+            m_pool = other.m_pool;
             m_info = other.m_info;
             m_size = other.m_size;
 
             // set old object to sane defaults
             other.m_buffer = nullptr;
-            other.m_allocated = false;
+            other.m_pool = nullptr;
             other.m_info = {0, 0};
             other.m_size = 0;
         }
         return *this;
-
     }
 
     Buffer::operator float*()
@@ -95,23 +138,11 @@ namespace ORCore
         return m_buffer;
     }
 
-
     void Buffer::clone_type(const Buffer& other)
     {
         if (this != &other)
         {
-            if (m_size != other.m_size)
-            {
-                // If we previously allocated and the new buffer size is different
-                // free the old memory
-                if (m_allocated)
-                {
-                    delete[] m_buffer;
-                }
-                m_buffer = new float[m_size];
-                m_allocated = true;
-
-            }
+            reserve(other);
             m_info = other.m_info;
             m_size = other.m_size;
         }
@@ -131,4 +162,4 @@ namespace ORCore
     {
         std::fill(m_buffer, m_buffer+m_size, 0.0f);
     }
-}
\ No newline at end of file
+}
@@ -5,6 +5,8 @@
 #include <memory>
 #include <algorithm>
 
+#include "bufferpool.hpp"
+
 namespace ORCore
 {
     struct BufferInfo
@@ -13,11 +15,19 @@ namespace ORCore
         int frames;
     };
 
+    // A view of interleaved audio.
+    // Buffers either view memory owned by someone else or own a block from a BufferPool, which they return
+    // when destroyed. Pool blocks are aligned and never come from the heap so owning Buffers can be created
+    // on the audio thread.
     class Buffer
     {
     public:
         Buffer();
+
+        // Takes a block from the default pool.
+        // Throws std::runtime_error if the pool is empty or the buffer doesn't fit in a block.
         Buffer(BufferInfo info);
+        Buffer(BufferInfo info, BufferPool& pool);
         Buffer(float* buffer, BufferInfo info);
         Buffer(const Buffer& other);
         Buffer(Buffer&& other);
@@ -28,6 +38,7 @@ namespace ORCore
 
         operator float*();
 
+        // Resize to match other without copying its samples.
         void clone_type(const Buffer& other);
 
         BufferInfo get_info();
@@ -35,9 +46,13 @@ namespace ORCore
         void clear();
 
     private:
+        void acquire(BufferPool& pool, int size);
+        void release();
+        void reserve(const Buffer& other);
+
         float* m_buffer;
-        bool m_allocated;
+        BufferPool* m_pool;
         BufferInfo m_info;
         int m_size;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include "bufferpool.hpp"
+
+namespace ORCore
+{
+    const size_t defaultBlockFloats = 8192;
+    const size_t defaultBlockCount = 64;
+
+    static const size_t floatsPerLine = audioAlignment / sizeof(float);
+
+    static uint64_t pack_head(uint32_t tag, uint32_t index)
+    {
+        return (static_cast<uint64_t>(tag) << 32) | index;
+    }
+
+    BufferPool::BufferPool(size_t blockFloats, size_t blockCount)
+    : m_blockFloats(((blockFloats + floatsPerLine - 1) / floatsPerLine) * floatsPerLine),
+    m_blockCount(blockCount),
+    m_arena(make_aligned_floats(m_blockFloats * blockCount)),
+    m_head(pack_head(0, blockCount > 0 ? 0 : emptyList)),
+    m_next(std::make_unique<std::atomic<uint32_t>[]>(blockCount)),
+    m_freeBlocks(blockCount)
+    {
+        // Initially every block is free, in order.
+        for (size_t i = 0; i < blockCount; ++i)
+        {
+            m_next[i].store(i + 1 < blockCount ? static_cast<uint32_t>(i + 1) : emptyList, std::memory_order_relaxed);
+        }
+    }
+
+    float* BufferPool::acquire()
+    {
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        while (true)
+        {
+            uint32_t index = static_cast<uint32_t>(head);
+            if (index == emptyList)
+            {
+                return nullptr;
+            }
+
+            uint32_t next = m_next[index].load(std::memory_order_relaxed);
+            if (m_head.compare_exchange_weak(head, pack_head(static_cast<uint32_t>(head >> 32) + 1, next),
+                                             std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                m_freeBlocks.fetch_sub(1, std::memory_order_relaxed);
+                return m_arena.get() + (index * m_blockFloats);
+            }
+        }
+    }
+
+    void BufferPool::release(float* block)
+    {
+        uint32_t index = static_cast<uint32_t>((block - m_arena.get()) / m_blockFloats);
+
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            m_next[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            if (m_head.compare_exchange_weak(head, pack_head(static_cast<uint32_t>(head >> 32) + 1, index),
+                                             std::memory_order_release, std::memory_order_relaxed))
+            {
+                m_freeBlocks.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    bool BufferPool::owns(const float* block)
+    {
+        return block >= m_arena.get() && block < m_arena.get() + (m_blockFloats * m_blockCount);
+    }
+
+    size_t BufferPool::get_block_capacity()
+    {
+        return m_blockFloats;
+    }
+
+    size_t BufferPool::get_block_count()
+    {
+        return m_blockCount;
+    }
+
+    size_t BufferPool::get_free_blocks()
+    {
+        return m_freeBlocks.load(std::memory_order_relaxed);
+    }
+
+    BufferPool& get_buffer_pool()
+    {
+        static BufferPool pool(defaultBlockFloats, defaultBlockCount);
+        return pool;
+    }
+}
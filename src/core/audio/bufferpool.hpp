@@ -0,0 +1,55 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    // Fixed size blocks of audio memory carved out of one preallocated arena.
+    // Every block starts on an `audioAlignment` boundary and is a whole number of cache lines long.
+    // Blocks are kept on a lock-free free list so acquire and release never touch the heap or a lock
+    // and are safe to call from the audio thread.
+    class BufferPool
+    {
+    public:
+        // blockFloats is rounded up to a whole number of cache lines.
+        BufferPool(size_t blockFloats, size_t blockCount);
+
+        BufferPool(const BufferPool& other) = delete;
+        BufferPool& operator=(const BufferPool& other) = delete;
+
+        // Returns nullptr if every block is in use.
+        float* acquire();
+
+        // Return a block from acquire(), blocks from another pool are not allowed.
+        void release(float* block);
+
+        bool owns(const float* block);
+        size_t get_block_capacity();
+        size_t get_block_count();
+        size_t get_free_blocks();
+
+    private:
+        static const uint32_t emptyList = 0xFFFFFFFF;
+
+        size_t m_blockFloats;
+        size_t m_blockCount;
+        AlignedFloats m_arena;
+
+        // The free list head packs a counter above the block index so a block popped and pushed back between
+        // another threads read and its compare exchange can't be mistaken for an unchanged list.
+        std::atomic<uint64_t> m_head;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+        std::atomic<size_t> m_freeBlocks;
+    };
+
+    // The pool Buffers allocate from by default.
+    // Blocks hold 8192 floats, 4096 frames of stereo or 1024 frames of 7.1.
+    BufferPool& get_buffer_pool();
+}
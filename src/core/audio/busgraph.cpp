@@ -0,0 +1,117 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include "busgraph.hpp"
+
+namespace ORCore
+{
+    const std::string BusGraph::master = "master";
+
+    BusGraph::BusGraph()
+    : m_maxFrames(0)
+    {
+    }
+
+    void BusGraph::set_format(StreamFormat format)
+    {
+        m_master.set_format(format);
+        for (auto &bus : m_buses)
+        {
+            bus.mixer->set_format(format);
+        }
+    }
+
+    void BusGraph::start(int maxFrames)
+    {
+        m_maxFrames = maxFrames;
+        m_master.start(maxFrames);
+        for (auto &bus : m_buses)
+        {
+            bus.mixer->start(maxFrames);
+        }
+    }
+
+    Mixer* BusGraph::add_bus(std::string name, std::string parent)
+    {
+        Mixer* parentMixer = get_bus(parent);
+        if (parentMixer == nullptr || get_bus(name) != nullptr)
+        {
+            return nullptr;
+        }
+
+        auto mixer = std::make_unique<Mixer>();
+        mixer->set_format(m_master.get_format());
+        if (m_maxFrames > 0)
+        {
+            mixer->start(m_maxFrames);
+        }
+
+        Mixer* bus = mixer.get();
+        m_buses.push_back({name, std::move(mixer), parentMixer});
+        parentMixer->add_source(bus);
+        return bus;
+    }
+
+    Mixer* BusGraph::get_bus(std::string name)
+    {
+        if (name == master)
+        {
+            return &m_master;
+        }
+
+        MixBus* bus = find_bus(name);
+        return bus != nullptr ? bus->mixer.get() : nullptr;
+    }
+
+    bool BusGraph::set_bus_gain(std::string name, float gain)
+    {
+        MixBus* bus = find_bus(name);
+        if (bus == nullptr)
+        {
+            return false;
+        }
+        return bus->parent->set_gain(bus->mixer.get(), gain);
+    }
+
+    void BusGraph::pull(Buffer& buffer)
+    {
+        m_master.pull(buffer);
+    }
+
+    StreamFormat BusGraph::get_format()
+    {
+        return m_master.get_format();
+    }
+
+    void BusGraph::set_pause(bool paused)
+    {
+        m_master.set_pause(paused);
+    }
+
+    bool BusGraph::is_paused()
+    {
+        return m_master.is_paused();
+    }
+
+    int64_t BusGraph::get_frame_position()
+    {
+        return m_master.get_frame_position();
+    }
+
+    void BusGraph::set_command_queue(CommandQueue* queue)
+    {
+        m_master.set_command_queue(queue);
+    }
+
+    MixBus* BusGraph::find_bus(std::string name)
+    {
+        for (auto &bus : m_buses)
+        {
+            if (bus.name == name)
+            {
+                return &bus;
+            }
+        }
+        return nullptr;
+    }
+}
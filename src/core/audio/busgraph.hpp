@@ -0,0 +1,68 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "streams.hpp"
+#include "mixer.hpp"
+
+namespace ORCore
+{
+    // A named submix. Its gain lives on the parent mixer's input so changes are smoothed like any other source.
+    struct MixBus
+    {
+        std::string name;
+        std::unique_ptr<Mixer> mixer;
+        Mixer* parent;
+    };
+
+    // Tree of submix mixers under a master mixer, matching the audio.volumes groups.
+    // Each bus mixes its sources into its own preallocated scratch and hands the result up to its parent,
+    // so one pull of the master walks the whole graph depth first without allocating.
+    // Bus gains can be changed at any time without touching the graph.
+    class BusGraph: public Stream
+    {
+    public:
+        static const std::string master;
+
+        BusGraph();
+
+        // Format every bus mixes at, so nothing is resampled between buses.
+        // Must not be called while the graph is being pulled from.
+        void set_format(StreamFormat format);
+
+        // Preallocate scratch memory of every bus for pulls of up to maxFrames.
+        void start(int maxFrames);
+
+        // Creates a bus feeding into parent, which defaults to the master bus.
+        // Returns nullptr if the name is taken or the parent does not exist.
+        Mixer* add_bus(std::string name, std::string parent = master);
+        Mixer* get_bus(std::string name);
+
+        // Linear gain of a whole bus, smoothed over the next pulled block.
+        bool set_bus_gain(std::string name, float gain);
+
+        void pull(Buffer& buffer);
+        StreamFormat get_format();
+
+        // Pausing the master stops every bus, so their frame positions stay identical.
+        void set_pause(bool paused);
+        bool is_paused();
+        int64_t get_frame_position();
+
+        // Commands are delivered on the master timeline, which every bus shares.
+        void set_command_queue(CommandQueue* queue);
+
+    private:
+        MixBus* find_bus(std::string name);
+
+        Mixer m_master;
+        int m_maxFrames;
+
+        // Buses are only added so pointers to their mixers stay valid.
+        std::vector<MixBus> m_buses;
+    };
+}
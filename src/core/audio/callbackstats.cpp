@@ -0,0 +1,127 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+
+#include "callbackstats.hpp"
+#include "audioclock.hpp"
+#include "rtlog.hpp"
+
+namespace ORCore
+{
+    // A gap this many times longer than the previous block means the device ran dry.
+    const double underrunGap = 1.5;
+
+    // Weight of the newest callback in the smoothed load.
+    const double loadSmoothing = 0.05;
+
+    CallbackStats::CallbackStats()
+    : m_sampleRate(44100),
+    m_callbacks(0),
+    m_underruns(0),
+    m_frames(0),
+    m_duration(0.0),
+    m_interval(0.0),
+    m_maxInterval(0.0),
+    m_load(0.0),
+    m_peakLoad(0.0),
+    m_resetPeak(false),
+    m_lastStart(0.0),
+    m_lastPeriod(0.0),
+    m_lastOverrun(false)
+    {
+    }
+
+    void CallbackStats::set_sample_rate(int sampleRate)
+    {
+        m_sampleRate.store(sampleRate, std::memory_order_relaxed);
+    }
+
+    void CallbackStats::reset()
+    {
+        m_callbacks.store(0);
+        m_underruns.store(0);
+        m_frames.store(0);
+        m_duration.store(0.0);
+        m_interval.store(0.0);
+        m_maxInterval.store(0.0);
+        m_load.store(0.0);
+        m_peakLoad.store(0.0);
+        m_resetPeak.store(false);
+        m_lastStart = 0.0;
+        m_lastPeriod = 0.0;
+        m_lastOverrun = false;
+    }
+
+    double CallbackStats::begin_callback()
+    {
+        return AudioClock::now();
+    }
+
+    void CallbackStats::end_callback(double start, int frames)
+    {
+        double end = AudioClock::now();
+        double duration = end - start;
+        double period = frames / static_cast<double>(m_sampleRate.load(std::memory_order_relaxed));
+        double load = period > 0.0 ? duration / period : 0.0;
+        bool underrun = duration > period;
+
+        if (m_lastStart > 0.0)
+        {
+            double interval = start - m_lastStart;
+            // A late callback after one that overran is the same underrun, don't count it twice.
+            if (interval > m_lastPeriod * underrunGap && !m_lastOverrun)
+            {
+                underrun = true;
+            }
+            m_interval.store(interval, std::memory_order_relaxed);
+            if (interval > m_maxInterval.load(std::memory_order_relaxed))
+            {
+                m_maxInterval.store(interval, std::memory_order_relaxed);
+            }
+        }
+        m_lastStart = start;
+        m_lastPeriod = period;
+        m_lastOverrun = duration > period;
+
+        // The peak is only reset from here so the audio thread stays the only writer.
+        double peak = m_peakLoad.load(std::memory_order_relaxed);
+        if (m_resetPeak.exchange(false, std::memory_order_relaxed))
+        {
+            peak = 0.0;
+            m_maxInterval.store(0.0, std::memory_order_relaxed);
+        }
+        m_peakLoad.store(std::max(peak, load), std::memory_order_relaxed);
+
+        double smoothed = m_load.load(std::memory_order_relaxed);
+        m_load.store(smoothed + ((load - smoothed) * loadSmoothing), std::memory_order_relaxed);
+
+        m_duration.store(duration, std::memory_order_relaxed);
+        m_frames.store(frames, std::memory_order_relaxed);
+        if (underrun)
+        {
+            rt_log(RtLogLevel::warn, "Audio underrun, callback took {}ms for {} frames.", duration * 1000.0, frames);
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_callbacks.fetch_add(1, std::memory_order_release);
+    }
+
+    CallbackStatsInfo CallbackStats::read()
+    {
+        CallbackStatsInfo info;
+        info.callbacks = m_callbacks.load(std::memory_order_acquire);
+        info.underruns = m_underruns.load(std::memory_order_relaxed);
+        info.frames = m_frames.load(std::memory_order_relaxed);
+        info.duration = m_duration.load(std::memory_order_relaxed);
+        info.interval = m_interval.load(std::memory_order_relaxed);
+        info.maxInterval = m_maxInterval.load(std::memory_order_relaxed);
+        info.load = m_load.load(std::memory_order_relaxed);
+        info.peakLoad = m_peakLoad.load(std::memory_order_relaxed);
+        return info;
+    }
+
+    void CallbackStats::reset_peak()
+    {
+        m_resetPeak.store(true, std::memory_order_relaxed);
+    }
+}
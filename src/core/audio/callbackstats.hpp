@@ -0,0 +1,67 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace ORCore
+{
+    // Loads are the time spent in the callback as a fraction of the audio it produced, 1.0 means no headroom left.
+    // Times are in seconds.
+    struct CallbackStatsInfo
+    {
+        uint64_t callbacks;
+        uint64_t underruns;
+        int frames;
+        double duration;
+        double interval;
+        double maxInterval;
+        double load;
+        double peakLoad;
+    };
+
+    // Health of the audio callback.
+    // The audio thread records each callback with plain atomic stores so it never waits,
+    // readers get values that are each up to date but may come from neighbouring callbacks.
+    // Underruns are not reported by every backend so they are inferred, either the callback took
+    // longer than the audio it produced or the gap since the previous callback was far longer than that audio.
+    class CallbackStats
+    {
+    public:
+        CallbackStats();
+
+        void set_sample_rate(int sampleRate);
+
+        // Clears everything, must not be called while callbacks are running.
+        void reset();
+
+        // Audio thread only, returns the start time to pass to end_callback.
+        double begin_callback();
+        void end_callback(double start, int frames);
+
+        // Safe from any thread.
+        CallbackStatsInfo read();
+
+        // Starts a new peak measurement, for example after changing the latency setting.
+        void reset_peak();
+
+    private:
+        std::atomic<int> m_sampleRate;
+
+        std::atomic<uint64_t> m_callbacks;
+        std::atomic<uint64_t> m_underruns;
+        std::atomic<int> m_frames;
+        std::atomic<double> m_duration;
+        std::atomic<double> m_interval;
+        std::atomic<double> m_maxInterval;
+        std::atomic<double> m_load;
+        std::atomic<double> m_peakLoad;
+        std::atomic_bool m_resetPeak;
+
+        // Only used by the audio thread.
+        double m_lastStart;
+        double m_lastPeriod;
+        bool m_lastOverrun;
+    };
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+
+#include "channelmapper.hpp"
+#include "kernels.hpp"
+
+namespace ORCore
+{
+    ChannelMapper::ChannelMapper(int channels, int blockFrames)
+    : m_stream(nullptr),
+    m_format({0, 0}),
+    m_channels(channels),
+    m_blockFrames(blockFrames)
+    {
+    }
+
+    bool ChannelMapper::add_source(Stream* stream)
+    {
+        if (stream->get_format().channels <= 0)
+        {
+            return false;
+        }
+
+        m_stream = stream;
+        m_format = m_stream->get_format();
+
+        // All memory used while pulling is allocated here rather than on the audio thread.
+        m_input = make_aligned_floats(static_cast<size_t>(m_blockFrames) * m_format.channels);
+        return true;
+    }
+
+    void ChannelMapper::pull(Buffer& buffer)
+    {
+        float* buf = buffer;
+        auto info = buffer.get_info();
+
+        int framesDone = 0;
+        while (framesDone < info.frames)
+        {
+            int frames = std::min(info.frames - framesDone, m_blockFrames);
+            Buffer input(m_input.get(), {m_format.channels, frames});
+            m_stream->pull(input);
+            map_channels(buf + (framesDone * info.channels), info.channels, m_input.get(), m_format.channels, frames);
+            framesDone += frames;
+        }
+    }
+
+    StreamFormat ChannelMapper::get_format()
+    {
+        return {m_format.sampleRate, m_channels};
+    }
+
+    bool ChannelMapper::is_paused()
+    {
+        return m_stream == nullptr || m_stream->is_paused();
+    }
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include "streams.hpp"
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    // Converts a stream to another channel layout, see map_channels for how channels are mapped.
+    // The source is pulled in its own layout in blocks of at most blockFrames.
+    class ChannelMapper: public InputStream
+    {
+    public:
+        ChannelMapper(int channels, int blockFrames = 1024);
+
+        bool add_source(Stream* stream);
+        void pull(Buffer& buffer);
+        StreamFormat get_format();
+
+        // Paused whenever the source is, the mixer skips it just like it would the source.
+        bool is_paused();
+
+    private:
+        Stream* m_stream;
+        StreamFormat m_format;
+        int m_channels;
+        int m_blockFrames;
+
+        // Source audio in the source layout, allocated by add_source.
+        AlignedFloats m_input;
+    };
+}
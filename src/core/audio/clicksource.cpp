@@ -0,0 +1,181 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <cmath>
+#include "clicksource.hpp"
+
+namespace ORCore
+{
+    const double pi = 3.14159265358979323846;
+
+    ClickSource::ClickSource(StreamFormat format)
+    : m_format(format),
+    m_enabled(true),
+    m_offset(0),
+    m_seekFrame(0),
+    m_seekPending(false),
+    m_nextVoice(0),
+    m_cursor(0),
+    m_cursorOffset(0),
+    m_position(0)
+    {
+        for (auto &voice : m_voices)
+        {
+            voice.active = false;
+        }
+        set_pause(false);
+        set_time(0.0);
+    }
+
+    int ClickSource::add_sound(const float* samples, int64_t frames, float gain)
+    {
+        ClickSound sound;
+        sound.samples = make_aligned_floats(static_cast<size_t>(frames));
+        std::copy(samples, samples + frames, sound.samples.get());
+        sound.frames = frames;
+        sound.gain = gain;
+
+        m_sounds.push_back(std::move(sound));
+        return static_cast<int>(m_sounds.size() - 1);
+    }
+
+    int ClickSource::add_tone(float frequency, double length, float gain)
+    {
+        int64_t frames = std::max<int64_t>(1, std::llround(length * m_format.sampleRate));
+
+        // Decays to about -60dB by the end so it never cuts off audibly.
+        double decay = 6.9 / frames;
+        double phaseStep = (2.0 * pi * frequency) / m_format.sampleRate;
+
+        std::vector<float> samples(frames);
+        for (int64_t i = 0; i < frames; ++i)
+        {
+            samples[i] = static_cast<float>(std::sin(phaseStep * i) * std::exp(-decay * i));
+        }
+        return add_sound(samples.data(), frames, gain);
+    }
+
+    void ClickSource::set_clicks(std::vector<Click> clicks)
+    {
+        m_schedule.clear();
+        m_schedule.reserve(clicks.size());
+        for (auto &click : clicks)
+        {
+            if (click.sound >= 0 && click.sound < static_cast<int>(m_sounds.size()))
+            {
+                m_schedule.push_back({std::llround(click.time * m_format.sampleRate), click.sound});
+            }
+        }
+
+        std::stable_sort(m_schedule.begin(), m_schedule.end(),
+            [](const ScheduledClick& a, const ScheduledClick& b)
+            {
+                return a.frame < b.frame;
+            });
+        find_cursor();
+    }
+
+    void ClickSource::set_enabled(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_release);
+    }
+
+    void ClickSource::set_offset(double offset)
+    {
+        m_offset.store(std::llround(offset * m_format.sampleRate), std::memory_order_release);
+    }
+
+    void ClickSource::seek(double time)
+    {
+        m_seekFrame.store(std::llround(time * m_format.sampleRate), std::memory_order_release);
+        m_seekPending.store(true, std::memory_order_release);
+    }
+
+    StreamFormat ClickSource::get_format()
+    {
+        return m_format;
+    }
+
+    // Only searched on a seek or offset change, playing never needs to search.
+    void ClickSource::find_cursor()
+    {
+        m_cursorOffset = m_offset.load(std::memory_order_acquire);
+        int64_t frame = m_position - m_cursorOffset;
+        auto next = std::lower_bound(m_schedule.begin(), m_schedule.end(), frame,
+            [](const ScheduledClick& click, int64_t value)
+            {
+                return click.frame < value;
+            });
+        m_cursor = static_cast<size_t>(next - m_schedule.begin());
+    }
+
+    void ClickSource::pull(Buffer& buffer)
+    {
+        if (m_seekPending.exchange(false, std::memory_order_acq_rel))
+        {
+            m_position = m_seekFrame.load(std::memory_order_acquire);
+            for (auto &voice : m_voices)
+            {
+                voice.active = false;
+            }
+            find_cursor();
+        }
+        else if (m_offset.load(std::memory_order_acquire) != m_cursorOffset)
+        {
+            find_cursor();
+        }
+
+        buffer.clear();
+        float* buf = buffer;
+        auto info = buffer.get_info();
+        int64_t end = m_position + info.frames;
+        bool enabled = m_enabled.load(std::memory_order_acquire);
+
+        while (m_cursor < m_schedule.size() && m_schedule[m_cursor].frame + m_cursorOffset < end)
+        {
+            const ScheduledClick& click = m_schedule[m_cursor];
+            if (enabled)
+            {
+                // Voices are reused in order so a new click replaces the oldest one.
+                ClickVoice& voice = m_voices[m_nextVoice];
+                m_nextVoice = (m_nextVoice + 1) % maxVoices;
+
+                voice.sound = click.sound;
+                voice.position = 0;
+                voice.offset = static_cast<int>(std::max<int64_t>(0, click.frame + m_cursorOffset - m_position));
+                voice.active = true;
+            }
+            m_cursor++;
+        }
+
+        for (auto &voice : m_voices)
+        {
+            if (!voice.active)
+            {
+                continue;
+            }
+
+            const ClickSound& sound = m_sounds[voice.sound];
+            int count = static_cast<int>(std::min<int64_t>(info.frames - voice.offset, sound.frames - voice.position));
+            const float* src = sound.samples.get() + voice.position;
+            float* dst = buf + (voice.offset * info.channels);
+
+            for (int i = 0; i < count; ++i)
+            {
+                float sample = src[i] * sound.gain;
+                for (int c = 0; c < info.channels; ++c)
+                {
+                    dst[(i * info.channels) + c] += sample;
+                }
+            }
+
+            voice.position += count;
+            voice.offset = 0;
+            voice.active = voice.position < sound.frames;
+        }
+
+        m_position = end;
+        set_time(static_cast<double>(m_position) / m_format.sampleRate);
+    }
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    // A click at a time in seconds from the start of the stream, sound is an id from add_sound or add_tone.
+    struct Click
+    {
+        double time;
+        int sound;
+    };
+
+    // Metronome that plays clicks on an exact frame of its own timeline, such as the beats of a song.
+    // Clicks are converted to frames once by set_clicks, so each pull only moves a cursor through the schedule.
+    // The stream always plays, set_enabled mutes it without losing its place.
+    class ClickSource: public ProducerStream
+    {
+    public:
+        ClickSource(StreamFormat format = {44100, 2});
+
+        // These allocate, call them before the source is added to a mixer.
+        // Sounds are mono at the sources rate. Returns the sound id.
+        int add_sound(const float* samples, int64_t frames, float gain = 1.0f);
+
+        // Adds a short decaying sine blip with a sharp start, good for hearing exactly where a beat lands.
+        int add_tone(float frequency, double length = 0.03, float gain = 1.0f);
+        void set_clicks(std::vector<Click> clicks);
+
+        // Safe to call from any thread.
+        void set_enabled(bool enabled);
+
+        // Play every click this many seconds late, negative values play them early.
+        // Used to calibrate the click against the audio output latency.
+        void set_offset(double offset);
+
+        // Takes effect at the start of the next pull.
+        void seek(double time);
+
+        StreamFormat get_format();
+        void pull(Buffer& buffer);
+
+    private:
+        struct ClickSound
+        {
+            AlignedFloats samples;
+            int64_t frames;
+            float gain;
+        };
+
+        struct ScheduledClick
+        {
+            int64_t frame;
+            int sound;
+        };
+
+        struct ClickVoice
+        {
+            int sound;
+            int64_t position;
+            int offset;
+            bool active;
+        };
+
+        void find_cursor();
+
+        StreamFormat m_format;
+        std::vector<ClickSound> m_sounds;
+        std::vector<ScheduledClick> m_schedule;
+
+        std::atomic_bool m_enabled;
+        std::atomic<int64_t> m_offset;
+        std::atomic<int64_t> m_seekFrame;
+        std::atomic_bool m_seekPending;
+
+        // Only used by the audio thread.
+        static const int maxVoices = 4;
+        ClickVoice m_voices[maxVoices];
+        int m_nextVoice;
+        size_t m_cursor;
+        int64_t m_cursorOffset;
+        int64_t m_position;
+    };
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+
+#include "commandqueue.hpp"
+#include "rtlog.hpp"
+
+namespace ORCore
+{
+    CommandQueue::CommandQueue(size_t capacity)
+    : m_queue(capacity),
+    m_pending(std::make_unique<StreamCommand[]>(capacity)),
+    m_maxPending(static_cast<int>(capacity)),
+    m_pendingCount(0)
+    {
+    }
+
+    bool CommandQueue::push(const StreamCommand& command)
+    {
+        return m_queue.push(command);
+    }
+
+    bool CommandQueue::cancel(Stream* target)
+    {
+        return m_queue.push({CommandType::cancel, 0, target, nullptr, 0.0});
+    }
+
+    // Move new commands into the pending list keeping it sorted, commands mostly arrive in order so this is cheap.
+    void CommandQueue::take_commands()
+    {
+        StreamCommand command;
+        while (m_queue.pop(command))
+        {
+            if (command.type == CommandType::cancel)
+            {
+                auto end = std::remove_if(m_pending.get(), m_pending.get() + m_pendingCount,
+                    [&command](const StreamCommand& pending) { return pending.target == command.target; });
+                m_pendingCount = static_cast<int>(end - m_pending.get());
+                continue;
+            }
+
+            if (m_pendingCount == m_maxPending)
+            {
+                rt_log(RtLogLevel::error, "Command queue full, dropped command for frame {}.", command.frame);
+                continue;
+            }
+
+            int index = m_pendingCount;
+            while (index > 0 && m_pending[index - 1].frame > command.frame)
+            {
+                m_pending[index] = m_pending[index - 1];
+                index--;
+            }
+            m_pending[index] = command;
+            m_pendingCount++;
+        }
+    }
+
+    void CommandQueue::dispatch(int64_t frame)
+    {
+        take_commands();
+
+        int applied = 0;
+        while (applied < m_pendingCount && m_pending[applied].frame <= frame)
+        {
+            m_pending[applied].target->apply_command(m_pending[applied]);
+            applied++;
+        }
+
+        if (applied > 0)
+        {
+            std::move(m_pending.get() + applied, m_pending.get() + m_pendingCount, m_pending.get());
+            m_pendingCount -= applied;
+        }
+    }
+
+    int CommandQueue::frames_until_next(int64_t frame, int maxFrames)
+    {
+        if (m_pendingCount == 0)
+        {
+            return maxFrames;
+        }
+        return static_cast<int>(std::max<int64_t>(1, std::min<int64_t>(maxFrames, m_pending[0].frame - frame)));
+    }
+}
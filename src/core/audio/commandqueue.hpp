@@ -0,0 +1,48 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <memory>
+#include <cstdint>
+
+#include "streams.hpp"
+#include "mpscqueue.hpp"
+
+namespace ORCore
+{
+    // Timestamped control commands from any thread to the audio thread.
+    // The mixer the queue is attached to splits its blocks at command frames and delivers each command to
+    // its target's apply_command right before the first frame it should affect, so pausing, seeking
+    // and muting happen on an exact sample rather than at the next callback.
+    // Commands for the same frame are applied in the order they were pushed.
+    class CommandQueue
+    {
+    public:
+        // capacity bounds both the queue and the commands waiting for a later block.
+        CommandQueue(size_t capacity = 1024);
+
+        // Safe to call from any thread, returns false if the queue is full.
+        bool push(const StreamCommand& command);
+
+        // Drops pending commands for a stream that is about to be destroyed.
+        // Push this after removing the stream from its mixer, it takes effect before anything else is applied.
+        bool cancel(Stream* target);
+
+        // Audio thread only.
+        // Applies every command due at or before frame.
+        void dispatch(int64_t frame);
+
+        // Number of frames, at most maxFrames, that can be mixed from frame before the next command is due.
+        int frames_until_next(int64_t frame, int maxFrames);
+
+    private:
+        void take_commands();
+
+        MpscQueue<StreamCommand> m_queue;
+
+        // Only used by the audio thread, kept sorted by frame.
+        std::unique_ptr<StreamCommand[]> m_pending;
+        int m_maxPending;
+        int m_pendingCount;
+    };
+}
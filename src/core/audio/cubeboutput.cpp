@@ -3,11 +3,15 @@
 
 
 #include <cstdarg>
+#include <algorithm>
 
 #include "cubeboutput.hpp"
 
 namespace ORCore
 {
+    // Frames converted at a time for 16 bit output.
+    const int convertFrames = 1024;
+
     void print_log(const char * msg, ...)
     {
       va_list args;
@@ -38,18 +42,61 @@ namespace ORCore
     }
 
 
+    StreamFormat CubebOutput::get_preferred_format()
+    {
+        uint32_t rate = 0;
+        if (m_context == nullptr || cubeb_get_preferred_sample_rate(m_context, &rate) != CUBEB_OK || rate == 0)
+        {
+            m_logger->warn("cubeb: Failed to get the preferred sample rate.");
+            rate = 44100;
+        }
+        return {static_cast<int>(rate), 2};
+    }
+
     void CubebOutput::build_buffer(Buffer& audioBuffer)
     {
-        if (!m_source->is_paused())
+        ClockSnapshot snapshot;
+        snapshot.timestamp = AudioClock::now();
+        snapshot.blockFrames = audioBuffer.get_info().frames;
+        snapshot.playing = !m_source->is_paused();
+
+        if (snapshot.playing)
         {
             m_source->pull(audioBuffer);
+            m_framesWritten += snapshot.blockFrames;
         }
         else
         {
             audioBuffer.clear();
         }
+        m_deviceFramesWritten += snapshot.blockFrames;
+
+        snapshot.frames = m_framesWritten;
+        snapshot.deviceFrames = m_deviceFramesWritten;
+        m_clock.publish(snapshot);
+    }
+
+
+    // Pull in float then convert, in pieces no larger than the conversion buffer.
+    void CubebOutput::build_int16_buffer(int16_t* output, int frames)
+    {
+        int framesConverted = 0;
+        while (framesConverted < frames)
+        {
+            int chunk = std::min(frames - framesConverted, convertFrames);
+            Buffer audioBuffer(m_convertBuffer.get(), {m_format.channels, chunk});
+            build_buffer(audioBuffer);
+
+            float_to_int16(output + (framesConverted * m_format.channels), m_convertBuffer.get(),
+                           static_cast<size_t>(chunk) * m_format.channels, m_dither);
+            framesConverted += chunk;
+        }
     }
 
+    void CubebOutput::set_sample_bits(int bits)
+    {
+        m_sampleBits = bits;
+    }
 
     bool CubebOutput::start()
     {
@@ -69,16 +116,24 @@ namespace ORCore
 
         cubeb_stream_params params;
         params.format = CUBEB_SAMPLE_FLOAT32NE; // Our entire audio pipeline will work in 32bit float.
+        if (m_sampleBits == 16)
+        {
+            // Only converted at the very end, all memory for that is allocated up front.
+            params.format = CUBEB_SAMPLE_S16NE;
+            m_convertBuffer = make_aligned_floats(static_cast<size_t>(convertFrames) * m_format.channels);
+            m_dither = make_dither_state(0x4f52u);
+        }
         params.rate = m_format.sampleRate;
         params.channels = m_format.channels;
         params.layout = CUBEB_LAYOUT_STEREO;
 
 
-        uint32_t rate;
-
-        cubeb_get_preferred_sample_rate(m_context, &rate);
-
-        m_logger->info("defult: {} picked: {}", rate, m_format.sampleRate);
+        StreamFormat preferred = get_preferred_format();
+        m_logger->info("defult: {} picked: {}", preferred.sampleRate, m_format.sampleRate);
+        if (preferred.sampleRate != m_format.sampleRate)
+        {
+            m_logger->warn("cubeb: Source rate differs from the device rate, the backend will resample.");
+        }
 
         uint32_t frameLatency = 0;
 
@@ -92,8 +147,17 @@ namespace ORCore
             const void* input_buffer, void* output_buffer, long nframes) -> long
         {
             auto* cubebOut = static_cast<CubebOutput*>(user_ptr);
-            Buffer audioBuffer(static_cast<float*>(output_buffer), {cubebOut->m_format.channels, static_cast<int>(nframes)});
-            cubebOut->build_buffer(audioBuffer);
+            double start = cubebOut->m_stats.begin_callback();
+            if (cubebOut->m_sampleBits == 16)
+            {
+                cubebOut->build_int16_buffer(static_cast<int16_t*>(output_buffer), static_cast<int>(nframes));
+            }
+            else
+            {
+                Buffer audioBuffer(static_cast<float*>(output_buffer), {cubebOut->m_format.channels, static_cast<int>(nframes)});
+                cubebOut->build_buffer(audioBuffer);
+            }
+            cubebOut->m_stats.end_callback(start, static_cast<int>(nframes));
             return nframes;
         };
 
@@ -108,6 +172,12 @@ namespace ORCore
             return false;
         }
 
+        m_clock.set_sample_rate(m_format.sampleRate);
+        m_clock.set_latency(frameLatency);
+        m_stats.set_sample_rate(m_format.sampleRate);
+        m_stats.reset();
+        m_latencyMeasured = false;
+
         if (cubeb_stream_start(m_stream) != CUBEB_OK)
         {
             m_logger->error("cubeb: Failed to start stream.");
@@ -117,6 +187,63 @@ namespace ORCore
         return true;
     }
 
+    AudioClock& CubebOutput::get_clock()
+    {
+        return m_clock;
+    }
+
+    CallbackStats& CubebOutput::get_stats()
+    {
+        return m_stats;
+    }
+
+    void CubebOutput::update_latency()
+    {
+        const double updateInterval = 0.5;
+
+        // Weight of a new measurement, the reported position is coarse on some backends.
+        const double smoothing = 0.1;
+
+        double now = AudioClock::now();
+        if (m_stream == nullptr || now - m_lastLatencyUpdate < updateInterval)
+        {
+            return;
+        }
+        m_lastLatencyUpdate = now;
+
+        ClockSnapshot snapshot = m_clock.read();
+        if (snapshot.deviceFrames == 0)
+        {
+            return;
+        }
+
+        double latency;
+        uint64_t position;
+        uint32_t deviceLatency;
+        if (cubeb_stream_get_position(m_stream, &position) == CUBEB_OK && position > 0)
+        {
+            // The device position counts silence written while the source was paused too so compare device frames.
+            double elapsed = now - snapshot.timestamp;
+            double written = snapshot.deviceFrames + (elapsed * m_format.sampleRate);
+            latency = written - std::min<double>(position, written);
+        }
+        else if (cubeb_stream_get_latency(m_stream, &deviceLatency) == CUBEB_OK)
+        {
+            latency = deviceLatency + snapshot.blockFrames;
+        }
+        else
+        {
+            return;
+        }
+
+        if (m_latencyMeasured)
+        {
+            latency = m_clock.get_latency() + ((latency - m_clock.get_latency()) * smoothing);
+        }
+        m_latencyMeasured = true;
+        m_clock.set_latency(latency);
+    }
+
     void CubebOutput::stop()
     {
         if (cubeb_stream_stop(m_stream) != CUBEB_OK)
@@ -124,5 +251,9 @@ namespace ORCore
             m_logger->error("cubeb: Failed to stop stream.");
         }
         cubeb_stream_destroy(m_stream);
+
+        CallbackStatsInfo stats = m_stats.read();
+        m_logger->info("Audio callbacks: {} underruns: {} load: {:.1f}% peak load: {:.1f}% longest gap: {:.2f}ms",
+            stats.callbacks, stats.underruns, stats.load * 100.0, stats.peakLoad * 100.0, stats.maxInterval * 1000.0);
     }
 }
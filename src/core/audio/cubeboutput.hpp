@@ -3,6 +3,10 @@
 
 #pragma once
 #include "streams.hpp"
+#include "audioclock.hpp"
+#include "callbackstats.hpp"
+#include "aligned.hpp"
+#include "kernels.hpp"
 
 #include <spdlog/spdlog.h>
 #include <cubeb/cubeb.h>
@@ -19,11 +23,44 @@ namespace ORCore
         void build_buffer(Buffer& buffer);
         void set_source(Stream* stream);
 
+        // 16 or 32, matching audio.backend.bits. 16 bit output is converted with dither.
+        // Must be set before start.
+        void set_sample_bits(int bits);
+
+        // The devices native format, opening the stream at this rate avoids resampling inside the backend.
+        StreamFormat get_preferred_format();
+
+        // Counts frames pulled from the source while it is not paused, so it lines up with the source's own frame count.
+        AudioClock& get_clock();
+
+        // Re-measures the output latency from the devices reported position, call regularly from the game thread.
+        // This is rate limited internally and does nothing until the stream is running.
+        void update_latency();
+
+        // Timing, load and underruns of the audio callback, readable from any thread.
+        // Use this to pick the lowest audio.backend.latency_ms that does not underrun.
+        CallbackStats& get_stats();
+
     private:
+        void build_int16_buffer(int16_t* output, int frames);
+
         std::shared_ptr<spdlog::logger> m_logger;
         StreamFormat m_format;
         Stream* m_source = nullptr;
-        cubeb* m_context;
-        cubeb_stream* m_stream;
+        cubeb* m_context = nullptr;
+        cubeb_stream* m_stream = nullptr;
+
+        AudioClock m_clock;
+        CallbackStats m_stats;
+        double m_lastLatencyUpdate = 0.0;
+        bool m_latencyMeasured = false;
+
+        int m_sampleBits = 32;
+
+        // Only used by the audio thread.
+        AlignedFloats m_convertBuffer;
+        DitherState m_dither;
+        int64_t m_framesWritten = 0;
+        int64_t m_deviceFramesWritten = 0;
     };
 }
@@ -0,0 +1,201 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <chrono>
+
+#include "decodeahead.hpp"
+#include "rtlog.hpp"
+
+namespace ORCore
+{
+    DecodeAhead::DecodeAhead(ProducerStream* source, int bufferFrames, int blockFrames, DecoderPool* pool)
+    : m_source(source),
+    m_pool(pool),
+    m_format(source->get_format()),
+    m_ring(static_cast<size_t>(bufferFrames) * m_format.channels),
+    m_decodeBuffer({m_format.channels, blockFrames}),
+    m_running(false),
+    m_seekTime(-1.0),
+    m_flushPosition(0),
+    m_flushTime(0.0),
+    m_flushGeneration(0),
+    m_generation(0),
+    m_basePosition(0),
+    m_baseTime(0.0),
+    m_skipSamples(0),
+    m_underruns(0)
+    {
+        set_pause(false);
+        set_time(0.0);
+    }
+
+    DecodeAhead::~DecodeAhead()
+    {
+        stop();
+    }
+
+    void DecodeAhead::start()
+    {
+        if (m_running.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        while (decode_step())
+        {
+        }
+
+        m_running.store(true, std::memory_order_release);
+        if (m_pool != nullptr)
+        {
+            m_pool->add(this);
+        }
+        else
+        {
+            m_thread = std::thread(&DecodeAhead::decode_loop, this);
+        }
+    }
+
+    void DecodeAhead::stop()
+    {
+        if (!m_running.exchange(false, std::memory_order_acq_rel))
+        {
+            return;
+        }
+
+        if (m_pool != nullptr)
+        {
+            m_pool->remove(this);
+        }
+        else if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    StreamFormat DecodeAhead::get_format()
+    {
+        return m_format;
+    }
+
+    void DecodeAhead::pull(Buffer& buffer)
+    {
+        float* buf = buffer;
+        size_t samples = static_cast<size_t>(buffer.size());
+
+        // Drop anything that was decoded before the last seek.
+        uint64_t generation = m_flushGeneration.load(std::memory_order_acquire);
+        if (generation != m_generation)
+        {
+            size_t flushPosition = m_flushPosition.load(std::memory_order_acquire);
+            m_ring.discard_to(flushPosition);
+            m_generation = generation;
+            m_basePosition = flushPosition;
+            m_baseTime = m_flushTime.load(std::memory_order_acquire);
+            m_skipSamples = 0;
+        }
+
+        // Audio that should have played during an earlier underrun is skipped so the stream stays on time.
+        if (m_skipSamples > 0)
+        {
+            size_t readPosition = m_ring.get_read_position();
+            size_t skipTo = std::min(readPosition + m_skipSamples, m_ring.get_write_position());
+            m_ring.discard_to(skipTo);
+            m_skipSamples -= skipTo - readPosition;
+        }
+
+        size_t samplesRead = m_ring.read(buf, samples);
+
+        if (samplesRead < samples)
+        {
+            std::fill(buf + samplesRead, buf + samples, 0.0f);
+
+            // Running out of data at the end of the source is expected, anything else is an underrun.
+            if (!m_source->is_paused() || m_seekTime.load(std::memory_order_acquire) >= 0.0)
+            {
+                m_underruns.fetch_add(1, std::memory_order_relaxed);
+                m_skipSamples += samples - samplesRead;
+                rt_log(RtLogLevel::warn, "Decoder underrun, {} samples missing.", samples - samplesRead);
+            }
+        }
+
+        size_t framesPlayed = (m_ring.get_read_position() - m_basePosition) / m_format.channels;
+        set_time(m_baseTime + (framesPlayed / static_cast<double>(m_format.sampleRate)));
+    }
+
+    void DecodeAhead::seek(double time)
+    {
+        m_seekTime.store(std::max(time, 0.0), std::memory_order_release);
+    }
+
+    int DecodeAhead::get_fill_level()
+    {
+        return static_cast<int>(m_ring.read_available() / m_format.channels);
+    }
+
+    int DecodeAhead::get_capacity()
+    {
+        return static_cast<int>(m_ring.capacity() / m_format.channels);
+    }
+
+    uint64_t DecodeAhead::get_underruns()
+    {
+        return m_underruns.load(std::memory_order_relaxed);
+    }
+
+    bool DecodeAhead::is_ready()
+    {
+        if (m_seekTime.load(std::memory_order_acquire) >= 0.0)
+        {
+            return false;
+        }
+
+        // Audio buffered before the last flush position is stale and doesn't count.
+        size_t writePos = m_ring.get_write_position();
+        size_t startPos = std::max(m_ring.get_read_position(), m_flushPosition.load(std::memory_order_acquire));
+        return writePos > startPos || m_source->is_paused();
+    }
+
+    bool DecodeAhead::decode_step()
+    {
+        double seekTime = m_seekTime.load(std::memory_order_acquire);
+        if (seekTime >= 0.0)
+        {
+            m_source->seek(seekTime);
+            m_source->set_pause(false);
+
+            m_flushTime.store(seekTime, std::memory_order_release);
+            m_flushPosition.store(m_ring.get_write_position(), std::memory_order_release);
+            m_flushGeneration.fetch_add(1, std::memory_order_acq_rel);
+
+            // Only clear the request once the flush is visible so is_ready never sees stale audio,
+            // if another seek came in meanwhile it is applied on the next step.
+            m_seekTime.compare_exchange_strong(seekTime, -1.0, std::memory_order_acq_rel);
+        }
+
+        if (m_source->is_paused())
+        {
+            return false;
+        }
+
+        if (m_ring.write_available() < static_cast<size_t>(m_decodeBuffer.size()))
+        {
+            return false;
+        }
+
+        m_source->pull(m_decodeBuffer);
+        m_ring.write(m_decodeBuffer, static_cast<size_t>(m_decodeBuffer.size()));
+        return true;
+    }
+
+    void DecodeAhead::decode_loop()
+    {
+        while (m_running.load(std::memory_order_acquire))
+        {
+            if (!decode_step())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    }
+}
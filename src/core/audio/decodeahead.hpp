@@ -0,0 +1,79 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include "streams.hpp"
+#include "ringbuffer.hpp"
+#include "decoderpool.hpp"
+
+namespace ORCore
+{
+    // Decodes a producer ahead of time on a background thread.
+    // The audio thread only ever copies already decoded samples out of a lock-free ring buffer
+    // so slow decoding or seeking can no longer stall the audio callback.
+    // Pausing this stream pauses playback, the source keeps decoding until the buffer is full.
+    // If a pool is given decoding is done by the pool's workers instead of a dedicated thread.
+    class DecodeAhead: public ProducerStream, public DecodeTask
+    {
+    public:
+        DecodeAhead(ProducerStream* source, int bufferFrames = 16384, int blockFrames = 1024, DecoderPool* pool = nullptr);
+        ~DecodeAhead();
+
+        // Fills the buffer on the calling thread then starts background decoding.
+        void start();
+        void stop();
+
+        // Decodes a single block if there is room for it.
+        bool decode_step();
+
+        StreamFormat get_format();
+        void pull(Buffer& buffer);
+
+        // Seeking is handled by the decoder thread, any already buffered audio is dropped.
+        void seek(double time);
+
+        // Number of decoded frames waiting to be played.
+        int get_fill_level();
+        int get_capacity();
+
+        // Number of pulls that could not be completely filled from the buffer.
+        uint64_t get_underruns();
+
+        // True once any pending seek has been applied and there is audio ready to play from the new position.
+        bool is_ready();
+
+    private:
+        void decode_loop();
+
+        ProducerStream* m_source;
+        DecoderPool* m_pool;
+        StreamFormat m_format;
+        RingBuffer<float> m_ring;
+
+        // Only used by the decoder thread.
+        Buffer m_decodeBuffer;
+
+        std::thread m_thread;
+        std::atomic_bool m_running;
+
+        std::atomic<double> m_seekTime;
+
+        // Written by the decoder thread after a seek, everything before this position is stale.
+        // The generation counts seeks, a seek doesn't always move the write position.
+        std::atomic<size_t> m_flushPosition;
+        std::atomic<double> m_flushTime;
+        std::atomic<uint64_t> m_flushGeneration;
+
+        // Only used by the audio thread.
+        uint64_t m_generation;
+        size_t m_basePosition;
+        double m_baseTime;
+        size_t m_skipSamples;
+
+        std::atomic<uint64_t> m_underruns;
+    };
+}
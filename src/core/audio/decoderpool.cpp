@@ -0,0 +1,114 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <chrono>
+#include <algorithm>
+
+#include "decoderpool.hpp"
+
+namespace ORCore
+{
+    DecoderPool::DecoderPool(int threadCount)
+    : m_nextTask(0), m_running(true)
+    {
+        for (int i = 0; i < threadCount; ++i)
+        {
+            m_threads.emplace_back(&DecoderPool::worker, this);
+        }
+    }
+
+    DecoderPool::~DecoderPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void DecoderPool::add(DecodeTask* task)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back({task, false});
+    }
+
+    void DecoderPool::remove(DecodeTask* task)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_taskDone.wait(lock, [&]()
+        {
+            PoolEntry* entry = find_entry(task);
+            return entry == nullptr || !entry->busy;
+        });
+
+        m_tasks.erase(std::remove_if(m_tasks.begin(), m_tasks.end(),
+            [&](const PoolEntry& entry)
+            {
+                return entry.task == task;
+            }),
+            m_tasks.end());
+    }
+
+    void DecoderPool::worker()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        size_t idleSteps = 0;
+
+        while (m_running)
+        {
+            // Round robin over the tasks that are not already being worked on.
+            DecodeTask* task = nullptr;
+            for (size_t i = 0; i < m_tasks.size(); ++i)
+            {
+                size_t index = (m_nextTask + i) % m_tasks.size();
+                if (!m_tasks[index].busy)
+                {
+                    task = m_tasks[index].task;
+                    m_tasks[index].busy = true;
+                    m_nextTask = index + 1;
+                    break;
+                }
+            }
+
+            bool worked = false;
+            if (task != nullptr)
+            {
+                lock.unlock();
+                worked = task->decode_step();
+                lock.lock();
+
+                PoolEntry* entry = find_entry(task);
+                if (entry != nullptr)
+                {
+                    entry->busy = false;
+                }
+                m_taskDone.notify_all();
+            }
+
+            // Sleep once every task has been given a chance without any of them having work.
+            idleSteps = worked ? 0 : idleSteps + 1;
+            if (task == nullptr || idleSteps >= m_tasks.size())
+            {
+                idleSteps = 0;
+                lock.unlock();
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                lock.lock();
+            }
+        }
+    }
+
+    DecoderPool::PoolEntry* DecoderPool::find_entry(DecodeTask* task)
+    {
+        for (auto &entry : m_tasks)
+        {
+            if (entry.task == task)
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+}
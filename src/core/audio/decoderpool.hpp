@@ -0,0 +1,51 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace ORCore
+{
+    // A unit of background decoding work.
+    class DecodeTask
+    {
+    public:
+        // Do a small amount of work, returns false if there was nothing to do.
+        // A task is never run on more than one thread at a time.
+        virtual bool decode_step() = 0;
+    };
+
+    // A small set of worker threads shared between many decode tasks.
+    // This keeps the thread count fixed no matter how many stems a song has.
+    class DecoderPool
+    {
+    public:
+        DecoderPool(int threadCount = 2);
+        ~DecoderPool();
+
+        void add(DecodeTask* task);
+
+        // Blocks until the task is no longer running on a worker, after this it is safe to destroy the task.
+        void remove(DecodeTask* task);
+
+    private:
+        struct PoolEntry
+        {
+            DecodeTask* task;
+            bool busy;
+        };
+
+        void worker();
+        PoolEntry* find_entry(DecodeTask* task);
+
+        std::vector<PoolEntry> m_tasks;
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_taskDone;
+        size_t m_nextTask;
+        bool m_running;
+    };
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include "config.hpp"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+#include "decoderregistry.hpp"
+#include "vorbissource.hpp"
+#include "wavsource.hpp"
+
+#if FLAC_ENABLED
+#include "flacsource.hpp"
+#endif
+
+#if OPUS_ENABLED
+#include "opussource.hpp"
+#endif
+
+namespace ORCore
+{
+    // Enough for every built in probe, the opus id header starts at byte 28 of the first ogg page.
+    const size_t probeSize = 64;
+
+    static bool is_ogg_opus(const unsigned char* header, size_t size)
+    {
+        return size >= 36 && std::memcmp(header, "OggS", 4) == 0 && std::memcmp(header + 28, "OpusHead", 8) == 0;
+    }
+
+    DecoderRegistry::DecoderRegistry()
+    {
+        add_decoder("vorbis",
+            [](const unsigned char* header, size_t size)
+            {
+                return size >= 4 && std::memcmp(header, "OggS", 4) == 0 && !is_ogg_opus(header, size);
+            },
+            [](std::string filename)
+            {
+                return std::unique_ptr<DecoderSource>(std::make_unique<VorbisSource>(filename));
+            });
+
+        add_decoder("wav",
+            [](const unsigned char* header, size_t size)
+            {
+                return size >= 12 && std::memcmp(header, "RIFF", 4) == 0 && std::memcmp(header + 8, "WAVE", 4) == 0;
+            },
+            [](std::string filename)
+            {
+                return std::unique_ptr<DecoderSource>(std::make_unique<WavSource>(filename));
+            });
+
+#if FLAC_ENABLED
+        add_decoder("flac",
+            [](const unsigned char* header, size_t size)
+            {
+                return size >= 4 && std::memcmp(header, "fLaC", 4) == 0;
+            },
+            [](std::string filename)
+            {
+                return std::unique_ptr<DecoderSource>(std::make_unique<FlacSource>(filename));
+            });
+#endif
+
+#if OPUS_ENABLED
+        add_decoder("opus", is_ogg_opus,
+            [](std::string filename)
+            {
+                return std::unique_ptr<DecoderSource>(std::make_unique<OpusSource>(filename));
+            });
+#endif
+    }
+
+    void DecoderRegistry::add_decoder(std::string name, DecoderProbe probe, DecoderFactory factory)
+    {
+        m_decoders.insert(m_decoders.begin(), DecoderEntry{name, probe, factory});
+    }
+
+    const DecoderEntry* DecoderRegistry::find_decoder(std::string filename)
+    {
+        std::ifstream file(filename, std::ios_base::binary);
+        if (!file)
+        {
+            return nullptr;
+        }
+
+        unsigned char header[probeSize];
+        file.read(reinterpret_cast<char*>(header), probeSize);
+        size_t size = static_cast<size_t>(file.gcount());
+
+        for (auto &decoder : m_decoders)
+        {
+            if (decoder.probe(header, size))
+            {
+                return &decoder;
+            }
+        }
+        return nullptr;
+    }
+
+    bool DecoderRegistry::can_open(std::string filename)
+    {
+        return find_decoder(filename) != nullptr;
+    }
+
+    std::unique_ptr<DecoderSource> DecoderRegistry::open(std::string filename)
+    {
+        const DecoderEntry* decoder = find_decoder(filename);
+        if (decoder == nullptr)
+        {
+            throw std::runtime_error("No decoder found for " + filename);
+        }
+        return decoder->factory(filename);
+    }
+
+    DecoderRegistry& get_decoder_registry()
+    {
+        static DecoderRegistry registry;
+        return registry;
+    }
+}
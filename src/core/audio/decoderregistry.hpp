@@ -0,0 +1,46 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "decodersource.hpp"
+
+namespace ORCore
+{
+    // Probes are given the first bytes of a file and return true if their decoder can read it.
+    using DecoderProbe = std::function<bool(const unsigned char* header, size_t size)>;
+    using DecoderFactory = std::function<std::unique_ptr<DecoderSource>(std::string filename)>;
+
+    struct DecoderEntry
+    {
+        std::string name;
+        DecoderProbe probe;
+        DecoderFactory factory;
+    };
+
+    // Picks a decoder for a file by looking at its contents rather than the extension.
+    // Decoders added later are probed first so they can override the built in ones.
+    class DecoderRegistry
+    {
+    public:
+        DecoderRegistry();
+
+        void add_decoder(std::string name, DecoderProbe probe, DecoderFactory factory);
+        bool can_open(std::string filename);
+
+        // Throws std::runtime_error if no decoder can read the file.
+        std::unique_ptr<DecoderSource> open(std::string filename);
+
+    private:
+        const DecoderEntry* find_decoder(std::string filename);
+
+        std::vector<DecoderEntry> m_decoders;
+    };
+
+    // The registry shared by everything that loads audio files.
+    DecoderRegistry& get_decoder_registry();
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <cstdint>
+
+#include "streams.hpp"
+
+namespace ORCore
+{
+    // Common interface of every file decoder, created through the DecoderRegistry.
+    // Decoders are not real time safe, they are meant to be wrapped by PcmCacheSource and DecodeAhead.
+    // Pulling in the decoder's own layout (get_format().channels) is the fast path, buffers with
+    // another channel count are mapped with the same rules as map_channels.
+    class DecoderSource: public ProducerStream
+    {
+    public:
+        virtual ~DecoderSource()
+        {
+        }
+
+        virtual double get_length() = 0;
+        virtual int64_t get_frame_count() = 0;
+
+        // Interleaved float samples of the whole file if the decoder can hand them out without decoding,
+        // for example a float wav file that is memory mapped. Otherwise nullptr.
+        virtual const float* get_samples()
+        {
+            return nullptr;
+        }
+
+        // False for formats that are cheap enough to decode that an on disk pcm cache is not worth it.
+        virtual bool use_cache_file()
+        {
+            return true;
+        }
+    };
+}
@@ -0,0 +1,232 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   define FFT_SSE
+#   include <xmmintrin.h>
+#endif
+
+#include "fft.hpp"
+
+namespace ORCore
+{
+    const double pi = 3.14159265358979323846;
+
+#if !defined(FFT_SSE)
+    // One decimation in frequency radix-4 butterfly on element j of each quarter of a block.
+    static void butterfly_scalar(float* re, float* im, int j, int quarter, const float* twiddles)
+    {
+        const float* w1r = twiddles;
+        const float* w1i = twiddles + quarter;
+        const float* w2r = twiddles + (quarter * 2);
+        const float* w2i = twiddles + (quarter * 3);
+        const float* w3r = twiddles + (quarter * 4);
+        const float* w3i = twiddles + (quarter * 5);
+
+        int i0 = j;
+        int i1 = j + quarter;
+        int i2 = j + (quarter * 2);
+        int i3 = j + (quarter * 3);
+
+        float t0r = re[i0] + re[i2];
+        float t0i = im[i0] + im[i2];
+        float t1r = re[i0] - re[i2];
+        float t1i = im[i0] - im[i2];
+        float t2r = re[i1] + re[i3];
+        float t2i = im[i1] + im[i3];
+
+        // (a1 - a3) * -i
+        float t3r = im[i1] - im[i3];
+        float t3i = re[i3] - re[i1];
+
+        re[i0] = t0r + t2r;
+        im[i0] = t0i + t2i;
+
+        float y1r = t1r + t3r;
+        float y1i = t1i + t3i;
+        float y2r = t0r - t2r;
+        float y2i = t0i - t2i;
+        float y3r = t1r - t3r;
+        float y3i = t1i - t3i;
+
+        re[i1] = (y1r * w1r[j]) - (y1i * w1i[j]);
+        im[i1] = (y1r * w1i[j]) + (y1i * w1r[j]);
+        re[i2] = (y2r * w2r[j]) - (y2i * w2i[j]);
+        im[i2] = (y2r * w2i[j]) + (y2i * w2r[j]);
+        re[i3] = (y3r * w3r[j]) - (y3i * w3i[j]);
+        im[i3] = (y3r * w3i[j]) + (y3i * w3r[j]);
+    }
+#endif
+
+#if defined(FFT_SSE)
+    static inline void complex_mul_store(float* re, float* im, __m128 yr, __m128 yi, const float* wr, const float* wi)
+    {
+        __m128 r = _mm_loadu_ps(wr);
+        __m128 i = _mm_loadu_ps(wi);
+        _mm_storeu_ps(re, _mm_sub_ps(_mm_mul_ps(yr, r), _mm_mul_ps(yi, i)));
+        _mm_storeu_ps(im, _mm_add_ps(_mm_mul_ps(yr, i), _mm_mul_ps(yi, r)));
+    }
+
+    // Four neighbouring butterflies at once, quarter is always a multiple of 4 here.
+    static void butterfly4_sse(float* re, float* im, int j, int quarter, const float* twiddles)
+    {
+        float* r0 = re + j;
+        float* r1 = r0 + quarter;
+        float* r2 = r1 + quarter;
+        float* r3 = r2 + quarter;
+        float* i0 = im + j;
+        float* i1 = i0 + quarter;
+        float* i2 = i1 + quarter;
+        float* i3 = i2 + quarter;
+
+        __m128 a0r = _mm_loadu_ps(r0);
+        __m128 a0i = _mm_loadu_ps(i0);
+        __m128 a1r = _mm_loadu_ps(r1);
+        __m128 a1i = _mm_loadu_ps(i1);
+        __m128 a2r = _mm_loadu_ps(r2);
+        __m128 a2i = _mm_loadu_ps(i2);
+        __m128 a3r = _mm_loadu_ps(r3);
+        __m128 a3i = _mm_loadu_ps(i3);
+
+        __m128 t0r = _mm_add_ps(a0r, a2r);
+        __m128 t0i = _mm_add_ps(a0i, a2i);
+        __m128 t1r = _mm_sub_ps(a0r, a2r);
+        __m128 t1i = _mm_sub_ps(a0i, a2i);
+        __m128 t2r = _mm_add_ps(a1r, a3r);
+        __m128 t2i = _mm_add_ps(a1i, a3i);
+        __m128 t3r = _mm_sub_ps(a1i, a3i);
+        __m128 t3i = _mm_sub_ps(a3r, a1r);
+
+        _mm_storeu_ps(r0, _mm_add_ps(t0r, t2r));
+        _mm_storeu_ps(i0, _mm_add_ps(t0i, t2i));
+
+        complex_mul_store(r1, i1, _mm_add_ps(t1r, t3r), _mm_add_ps(t1i, t3i),
+                          twiddles + j, twiddles + quarter + j);
+        complex_mul_store(r2, i2, _mm_sub_ps(t0r, t2r), _mm_sub_ps(t0i, t2i),
+                          twiddles + (quarter * 2) + j, twiddles + (quarter * 3) + j);
+        complex_mul_store(r3, i3, _mm_sub_ps(t1r, t3r), _mm_sub_ps(t1i, t3i),
+                          twiddles + (quarter * 4) + j, twiddles + (quarter * 5) + j);
+    }
+#endif
+
+    Fft::Fft(int size)
+    : m_size(size)
+    {
+        int stages = 0;
+        for (int length = 1; length < size; length *= 4)
+        {
+            stages++;
+        }
+        if (size < 4 || (1 << (stages * 2)) != size)
+        {
+            throw std::runtime_error("FFT size must be a power of 4.");
+        }
+
+        // Every stage but the last, which has no twiddles, stores 6 floats per butterfly.
+        size_t tableSize = 0;
+        for (int length = size; length >= 16; length /= 4)
+        {
+            tableSize += (length / 4) * 6;
+        }
+        m_twiddles = make_aligned_floats(std::max<size_t>(tableSize, 1));
+
+        float* table = m_twiddles.get();
+        for (int length = size; length >= 16; length /= 4)
+        {
+            int quarter = length / 4;
+            for (int power = 1; power <= 3; ++power)
+            {
+                for (int j = 0; j < quarter; ++j)
+                {
+                    double angle = (-2.0 * pi * power * j) / length;
+                    table[j] = static_cast<float>(std::cos(angle));
+                    table[quarter + j] = static_cast<float>(std::sin(angle));
+                }
+                table += quarter * 2;
+            }
+        }
+
+        // Decimation in frequency leaves the output in base 4 digit reversed order.
+        m_reverse.resize(size);
+        for (int i = 0; i < size; ++i)
+        {
+            int value = i;
+            int reversed = 0;
+            for (int s = 0; s < stages; ++s)
+            {
+                reversed = (reversed * 4) + (value & 3);
+                value >>= 2;
+            }
+            m_reverse[i] = reversed;
+        }
+    }
+
+    void Fft::forward(float* real, float* imag)
+    {
+        const float* twiddles = m_twiddles.get();
+        for (int length = m_size; length >= 16; length /= 4)
+        {
+            int quarter = length / 4;
+            for (int block = 0; block < m_size; block += length)
+            {
+                float* re = real + block;
+                float* im = imag + block;
+#if defined(FFT_SSE)
+                for (int j = 0; j < quarter; j += 4)
+                {
+                    butterfly4_sse(re, im, j, quarter, twiddles);
+                }
+#else
+                for (int j = 0; j < quarter; ++j)
+                {
+                    butterfly_scalar(re, im, j, quarter, twiddles);
+                }
+#endif
+            }
+            twiddles += quarter * 6;
+        }
+
+        // The last stage is 4 point transforms where every twiddle is 1.
+        for (int block = 0; block < m_size; block += 4)
+        {
+            float* re = real + block;
+            float* im = imag + block;
+            float t0r = re[0] + re[2];
+            float t0i = im[0] + im[2];
+            float t1r = re[0] - re[2];
+            float t1i = im[0] - im[2];
+            float t2r = re[1] + re[3];
+            float t2i = im[1] + im[3];
+            float t3r = im[1] - im[3];
+            float t3i = re[3] - re[1];
+
+            re[0] = t0r + t2r;
+            im[0] = t0i + t2i;
+            re[1] = t1r + t3r;
+            im[1] = t1i + t3i;
+            re[2] = t0r - t2r;
+            im[2] = t0i - t2i;
+            re[3] = t1r - t3r;
+            im[3] = t1i - t3i;
+        }
+
+        for (int i = 0; i < m_size; ++i)
+        {
+            int j = m_reverse[i];
+            if (i < j)
+            {
+                std::swap(real[i], real[j]);
+                std::swap(imag[i], imag[j]);
+            }
+        }
+    }
+
+    int Fft::get_size()
+    {
+        return m_size;
+    }
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <vector>
+
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    // Radix-4 complex FFT for sizes that are a power of 4.
+    // Data is split into real and imaginary arrays so four butterflies run at once with SSE.
+    // Tables are built by the constructor, transforms never allocate.
+    class Fft
+    {
+    public:
+        // Throws std::runtime_error if size is not a power of 4 of at least 4.
+        Fft(int size);
+
+        // In place forward transform, output is in natural order.
+        void forward(float* real, float* imag);
+
+        int get_size();
+
+    private:
+        int m_size;
+
+        // Per stage twiddles for the three lower quarters as real and imaginary runs, largest stage first.
+        AlignedFloats m_twiddles;
+        std::vector<int> m_reverse;
+    };
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <cstring>
+
+#include "fileoutput.hpp"
+
+namespace ORCore
+{
+    // WAV files are always little endian.
+    template<typename T>
+    static void write_le(std::ofstream& file, T value)
+    {
+        char bytes[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            bytes[i] = static_cast<char>((static_cast<uint64_t>(value) >> (i * 8)) & 0xFF);
+        }
+        file.write(bytes, sizeof(T));
+    }
+
+    FileOutput::FileOutput(std::string filename, int blockFrames)
+    : OfflineOutput(blockFrames),
+    m_filename(filename),
+    m_format({0, 0}),
+    m_dataBytes(0)
+    {
+    }
+
+    FileOutput::~FileOutput()
+    {
+        stop();
+    }
+
+    bool FileOutput::open(StreamFormat format)
+    {
+        m_format = format;
+        m_dataBytes = 0;
+
+        m_file.open(m_filename, std::ios_base::binary | std::ios_base::trunc);
+        if (!m_file)
+        {
+            m_logger->error("Failed to open {} for writing.", m_filename);
+            return false;
+        }
+
+        // Written with an empty data size first, close() fills in the real sizes.
+        write_header();
+        return true;
+    }
+
+    void FileOutput::write(Buffer& buffer)
+    {
+        const float* samples = buffer;
+        size_t bytes = static_cast<size_t>(buffer.size()) * sizeof(float);
+        m_bytes.resize(bytes);
+
+        // Byte swizzle into little endian so this also works on big endian hosts.
+        for (int i = 0; i < buffer.size(); ++i)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, samples + i, sizeof(bits));
+            for (size_t b = 0; b < sizeof(bits); ++b)
+            {
+                m_bytes[(i * sizeof(bits)) + b] = static_cast<char>((bits >> (b * 8)) & 0xFF);
+            }
+        }
+        m_file.write(m_bytes.data(), bytes);
+        m_dataBytes += static_cast<uint32_t>(bytes);
+    }
+
+    void FileOutput::close()
+    {
+        m_file.seekp(0, std::ios::beg);
+        write_header();
+        m_file.close();
+    }
+
+    void FileOutput::write_header()
+    {
+        const uint16_t formatFloat = 3;
+        const uint16_t bitsPerSample = 32;
+        uint16_t blockAlign = static_cast<uint16_t>(m_format.channels * (bitsPerSample / 8));
+        uint32_t byteRate = static_cast<uint32_t>(m_format.sampleRate) * blockAlign;
+
+        m_file.write("RIFF", 4);
+        write_le<uint32_t>(m_file, 36 + m_dataBytes);
+        m_file.write("WAVE", 4);
+
+        m_file.write("fmt ", 4);
+        write_le<uint32_t>(m_file, 16);
+        write_le<uint16_t>(m_file, formatFloat);
+        write_le<uint16_t>(m_file, static_cast<uint16_t>(m_format.channels));
+        write_le<uint32_t>(m_file, static_cast<uint32_t>(m_format.sampleRate));
+        write_le<uint32_t>(m_file, byteRate);
+        write_le<uint16_t>(m_file, blockAlign);
+        write_le<uint16_t>(m_file, bitsPerSample);
+
+        m_file.write("data", 4);
+        write_le<uint32_t>(m_file, m_dataBytes);
+    }
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+
+#include "offlineoutput.hpp"
+
+namespace ORCore
+{
+    // Renders a stream into a 32bit float WAV file faster than realtime.
+    class FileOutput: public OfflineOutput
+    {
+    public:
+        FileOutput(std::string filename, int blockFrames = 1024);
+        ~FileOutput();
+
+    protected:
+        bool open(StreamFormat format);
+        void write(Buffer& buffer);
+        void close();
+
+    private:
+        void write_header();
+
+        std::string m_filename;
+        std::ofstream m_file;
+        std::vector<char> m_bytes;
+        StreamFormat m_format;
+        uint32_t m_dataBytes;
+    };
+}
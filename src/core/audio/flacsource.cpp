@@ -0,0 +1,178 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "flacsource.hpp"
+#include "kernels.hpp"
+
+namespace ORCore
+{
+    // Flac allows at most 8 channels.
+    const int maxFlacChannels = 8;
+
+    FlacSource::FlacSource(std::string filename)
+    : m_decoder(FLAC__stream_decoder_new()),
+    m_format({0, 0}),
+    m_bitsPerSample(16),
+    m_totalFrames(0),
+    m_timeSeek(-1.0),
+    m_blockCapacity(0),
+    m_blockFrames(0),
+    m_blockPosition(0),
+    m_position(0)
+    {
+        if (m_decoder == nullptr)
+        {
+            throw std::runtime_error("Flac: Failed to create decoder.");
+        }
+
+        if (FLAC__stream_decoder_init_file(m_decoder, filename.c_str(), write_callback, metadata_callback,
+                                           error_callback, this) != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+        {
+            FLAC__stream_decoder_delete(m_decoder);
+            throw std::runtime_error("Flac: Failed to open " + filename);
+        }
+
+        if (!FLAC__stream_decoder_process_until_end_of_metadata(m_decoder) || m_format.channels == 0)
+        {
+            FLAC__stream_decoder_delete(m_decoder);
+            throw std::runtime_error("Flac: Invalid stream info in " + filename);
+        }
+
+        set_pause(false);
+        set_time(0.0);
+    }
+
+    FlacSource::~FlacSource()
+    {
+        FLAC__stream_decoder_finish(m_decoder);
+        FLAC__stream_decoder_delete(m_decoder);
+    }
+
+    void FlacSource::metadata_callback(const FLAC__StreamDecoder* decoder,
+                                       const FLAC__StreamMetadata* metadata, void* userData)
+    {
+        auto* source = static_cast<FlacSource*>(userData);
+        if (metadata->type != FLAC__METADATA_TYPE_STREAMINFO)
+        {
+            return;
+        }
+
+        const FLAC__StreamMetadata_StreamInfo& info = metadata->data.stream_info;
+        source->m_format = {static_cast<int>(info.sample_rate), static_cast<int>(info.channels)};
+        source->m_bitsPerSample = static_cast<int>(info.bits_per_sample);
+        source->m_totalFrames = static_cast<int64_t>(info.total_samples);
+
+        // Allocated once for the largest block the stream can contain.
+        source->m_blockCapacity = static_cast<int>(info.max_blocksize);
+        source->m_block = make_aligned_floats(static_cast<size_t>(source->m_blockCapacity) * info.channels);
+    }
+
+    FLAC__StreamDecoderWriteStatus FlacSource::write_callback(const FLAC__StreamDecoder* decoder,
+        const FLAC__Frame* frame, const FLAC__int32* const buffer[], void* userData)
+    {
+        auto* source = static_cast<FlacSource*>(userData);
+        int frames = std::min(static_cast<int>(frame->header.blocksize), source->m_blockCapacity);
+        float scale = 1.0f / static_cast<float>(1u << (source->m_bitsPerSample - 1));
+
+        for (int c = 0; c < source->m_format.channels; ++c)
+        {
+            float* channel = source->m_block.get() + (c * source->m_blockCapacity);
+            for (int i = 0; i < frames; ++i)
+            {
+                channel[i] = buffer[c][i] * scale;
+            }
+        }
+
+        source->m_blockFrames = frames;
+        source->m_blockPosition = 0;
+        if (frame->header.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER)
+        {
+            source->m_position = static_cast<int64_t>(frame->header.number.sample_number);
+        }
+        return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+    }
+
+    void FlacSource::error_callback(const FLAC__StreamDecoder* decoder,
+                                    FLAC__StreamDecoderErrorStatus status, void* userData)
+    {
+        // Lost sync and bad frames are skipped by libFLAC, there is nothing more to do here.
+    }
+
+    StreamFormat FlacSource::get_format()
+    {
+        return m_format;
+    }
+
+    void FlacSource::pull(Buffer& buffer)
+    {
+        float* buf = buffer;
+        auto info = buffer.get_info();
+        int framesRead = 0;
+
+        // Apply any pending seek before reading so the data pulled is from the new position.
+        double seekTime = m_timeSeek.exchange(-1.0, std::memory_order_acq_rel);
+        if (seekTime >= 0.0)
+        {
+            auto frame = std::min<int64_t>(static_cast<int64_t>(seekTime * m_format.sampleRate), m_totalFrames);
+            m_blockFrames = 0;
+            m_blockPosition = 0;
+            if (!FLAC__stream_decoder_seek_absolute(m_decoder, static_cast<FLAC__uint64>(frame)))
+            {
+                FLAC__stream_decoder_flush(m_decoder);
+            }
+        }
+
+        while (framesRead < info.frames)
+        {
+            if (m_blockPosition >= m_blockFrames)
+            {
+                // Corrupt data is skipped without producing a frame, keep going until one arrives or the stream ends.
+                m_blockFrames = 0;
+                while (m_blockFrames == 0 &&
+                       FLAC__stream_decoder_process_single(m_decoder) &&
+                       FLAC__stream_decoder_get_state(m_decoder) != FLAC__STREAM_DECODER_END_OF_STREAM)
+                {
+                }
+
+                if (m_blockFrames == 0)
+                {
+                    // End of the stream or an unrecoverable error, pause and silence the rest of the buffer.
+                    set_pause(true);
+                    std::fill(buf + (framesRead * info.channels), buf + buffer.size(), 0.0f);
+                    break;
+                }
+            }
+
+            int frames = std::min(info.frames - framesRead, m_blockFrames - m_blockPosition);
+            const float* channels[maxFlacChannels];
+            for (int c = 0; c < m_format.channels; ++c)
+            {
+                channels[c] = m_block.get() + (c * m_blockCapacity) + m_blockPosition;
+            }
+
+            interleave_mapped(buf + (framesRead * info.channels), info.channels, channels, m_format.channels, frames);
+            framesRead += frames;
+            m_blockPosition += frames;
+        }
+
+        set_time((m_position + m_blockPosition) / static_cast<double>(m_format.sampleRate));
+    }
+
+    void FlacSource::seek(double time)
+    {
+        m_timeSeek.store(time, std::memory_order_release);
+    }
+
+    double FlacSource::get_length()
+    {
+        return m_totalFrames / static_cast<double>(m_format.sampleRate);
+    }
+
+    int64_t FlacSource::get_frame_count()
+    {
+        return m_totalFrames;
+    }
+}
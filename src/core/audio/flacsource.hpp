@@ -0,0 +1,50 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+#include <FLAC/stream_decoder.h>
+
+#include "decodersource.hpp"
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    class FlacSource: public DecoderSource
+    {
+    public:
+        // Throws std::runtime_error if the file can't be opened.
+        FlacSource(std::string filename);
+        ~FlacSource();
+
+        StreamFormat get_format();
+        void pull(Buffer& buffer);
+        void seek(double time);
+        double get_length();
+        int64_t get_frame_count();
+
+    private:
+        static FLAC__StreamDecoderWriteStatus write_callback(const FLAC__StreamDecoder* decoder,
+            const FLAC__Frame* frame, const FLAC__int32* const buffer[], void* userData);
+        static void metadata_callback(const FLAC__StreamDecoder* decoder,
+            const FLAC__StreamMetadata* metadata, void* userData);
+        static void error_callback(const FLAC__StreamDecoder* decoder,
+            FLAC__StreamDecoderErrorStatus status, void* userData);
+
+        FLAC__StreamDecoder* m_decoder;
+        StreamFormat m_format;
+        int m_bitsPerSample;
+        int64_t m_totalFrames;
+        std::atomic<double> m_timeSeek;
+
+        // The last decoded flac frame, planar so it goes through the interleave kernel.
+        AlignedFloats m_block;
+        int m_blockCapacity;
+        int m_blockFrames;
+        int m_blockPosition;
+        int64_t m_position;
+    };
+}
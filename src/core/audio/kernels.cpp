@@ -0,0 +1,542 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define KERNELS_SSE2
+#   include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <intrin.h>
+#endif
+
+#include "kernels.hpp"
+
+namespace ORCore
+{
+    const float int16Scale = 32767.0f;
+
+    static uint32_t xorshift(uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform random number in [0, 1) from the top 23 bits.
+    static float random_unit(uint32_t& state)
+    {
+        return (xorshift(state) >> 9) * (1.0f / 8388608.0f);
+    }
+
+    DitherState make_dither_state(uint32_t seed)
+    {
+        DitherState dither;
+        uint32_t state = seed != 0 ? seed : 0x9e3779b9u;
+        for (auto &lane : dither.lanes)
+        {
+            // Splitmix style scrambling so lanes don't start correlated, xorshift state must not be zero.
+            state += 0x9e3779b9u;
+            uint32_t value = state;
+            value = (value ^ (value >> 16)) * 0x85ebca6bu;
+            value = (value ^ (value >> 13)) * 0xc2b2ae35u;
+            value ^= value >> 16;
+            lane = value != 0 ? value : 1;
+        }
+        return dither;
+    }
+
+    /////////////////////////////////////
+    // Scalar kernels
+    /////////////////////////////////////
+
+    static void interleave_scalar(float* dst, const float* const* src, int frames, int channels)
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            const float* channel = src[c];
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                dst[(frame * channels) + c] = channel[frame];
+            }
+        }
+    }
+
+    static void deinterleave_scalar(float* const* dst, const float* src, int frames, int channels)
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            float* channel = dst[c];
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                channel[frame] = src[(frame * channels) + c];
+            }
+        }
+    }
+
+    static void interleave2_scalar(float* dst, const float* left, const float* right, int frames)
+    {
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            dst[frame * 2] = left[frame];
+            dst[(frame * 2) + 1] = right[frame];
+        }
+    }
+
+    static void deinterleave2_scalar(float* left, float* right, const float* src, int frames)
+    {
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            left[frame] = src[frame * 2];
+            right[frame] = src[(frame * 2) + 1];
+        }
+    }
+
+    static void interleave8_scalar(float* dst, const float* const* src, int frames)
+    {
+        interleave_scalar(dst, src, frames, 8);
+    }
+
+    static void deinterleave8_scalar(float* const* dst, const float* src, int frames)
+    {
+        deinterleave_scalar(dst, src, frames, 8);
+    }
+
+    static void apply_gain_scalar(float* samples, size_t count, float gain)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            samples[i] *= gain;
+        }
+    }
+
+    static float dot_product_scalar(const float* a, const float* b, size_t count)
+    {
+        float sum = 0.0f;
+        for (size_t i = 0; i < count; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    static void float_to_int16_scalar(int16_t* dst, const float* src, size_t count, DitherState& dither)
+    {
+        uint32_t& state = dither.lanes[0];
+        for (size_t i = 0; i < count; ++i)
+        {
+            float tpdf = random_unit(state) - random_unit(state);
+            float value = (src[i] * int16Scale) + tpdf;
+            value = std::max(-32768.0f, std::min(32767.0f, value));
+            dst[i] = static_cast<int16_t>(std::lrint(value));
+        }
+    }
+
+    static const KernelTable scalarKernels = {
+        "scalar",
+        interleave2_scalar,
+        deinterleave2_scalar,
+        interleave8_scalar,
+        deinterleave8_scalar,
+        apply_gain_scalar,
+        float_to_int16_scalar,
+        dot_product_scalar,
+    };
+
+    /////////////////////////////////////
+    // SSE2 kernels
+    /////////////////////////////////////
+
+#if defined(KERNELS_SSE2)
+    static void interleave2_sse2(float* dst, const float* left, const float* right, int frames)
+    {
+        int frame = 0;
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            __m128 l = _mm_loadu_ps(left + frame);
+            __m128 r = _mm_loadu_ps(right + frame);
+            _mm_storeu_ps(dst + (frame * 2), _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(dst + (frame * 2) + 4, _mm_unpackhi_ps(l, r));
+        }
+        interleave2_scalar(dst + (frame * 2), left + frame, right + frame, frames - frame);
+    }
+
+    static void deinterleave2_sse2(float* left, float* right, const float* src, int frames)
+    {
+        int frame = 0;
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            __m128 a = _mm_loadu_ps(src + (frame * 2));
+            __m128 b = _mm_loadu_ps(src + (frame * 2) + 4);
+            _mm_storeu_ps(left + frame, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(right + frame, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+        deinterleave2_scalar(left + frame, right + frame, src + (frame * 2), frames - frame);
+    }
+
+    // Transpose 4 frames of 4 channels starting at firstChannel into frames of `channels` floats.
+    static void interleave_4x4_sse2(float* dst, const float* const* src, int frame, int firstChannel, int channels)
+    {
+        __m128 r0 = _mm_loadu_ps(src[firstChannel] + frame);
+        __m128 r1 = _mm_loadu_ps(src[firstChannel + 1] + frame);
+        __m128 r2 = _mm_loadu_ps(src[firstChannel + 2] + frame);
+        __m128 r3 = _mm_loadu_ps(src[firstChannel + 3] + frame);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(dst + (frame * channels) + firstChannel, r0);
+        _mm_storeu_ps(dst + ((frame + 1) * channels) + firstChannel, r1);
+        _mm_storeu_ps(dst + ((frame + 2) * channels) + firstChannel, r2);
+        _mm_storeu_ps(dst + ((frame + 3) * channels) + firstChannel, r3);
+    }
+
+    static void deinterleave_4x4_sse2(float* const* dst, const float* src, int frame, int firstChannel, int channels)
+    {
+        __m128 r0 = _mm_loadu_ps(src + (frame * channels) + firstChannel);
+        __m128 r1 = _mm_loadu_ps(src + ((frame + 1) * channels) + firstChannel);
+        __m128 r2 = _mm_loadu_ps(src + ((frame + 2) * channels) + firstChannel);
+        __m128 r3 = _mm_loadu_ps(src + ((frame + 3) * channels) + firstChannel);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(dst[firstChannel] + frame, r0);
+        _mm_storeu_ps(dst[firstChannel + 1] + frame, r1);
+        _mm_storeu_ps(dst[firstChannel + 2] + frame, r2);
+        _mm_storeu_ps(dst[firstChannel + 3] + frame, r3);
+    }
+
+    static void interleave8_sse2(float* dst, const float* const* src, int frames)
+    {
+        int frame = 0;
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            interleave_4x4_sse2(dst, src, frame, 0, 8);
+            interleave_4x4_sse2(dst, src, frame, 4, 8);
+        }
+
+        const float* tail[8];
+        for (int c = 0; c < 8; ++c)
+        {
+            tail[c] = src[c] + frame;
+        }
+        interleave_scalar(dst + (frame * 8), tail, frames - frame, 8);
+    }
+
+    static void deinterleave8_sse2(float* const* dst, const float* src, int frames)
+    {
+        int frame = 0;
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            deinterleave_4x4_sse2(dst, src, frame, 0, 8);
+            deinterleave_4x4_sse2(dst, src, frame, 4, 8);
+        }
+
+        float* tail[8];
+        for (int c = 0; c < 8; ++c)
+        {
+            tail[c] = dst[c] + frame;
+        }
+        deinterleave_scalar(tail, src + (frame * 8), frames - frame, 8);
+    }
+
+    // 5.1 is done as a 4x4 transpose plus the last two channels as pairs.
+    static void interleave6_sse2(float* dst, const float* const* src, int frames)
+    {
+        int frame = 0;
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            __m128 c4 = _mm_loadu_ps(src[4] + frame);
+            __m128 c5 = _mm_loadu_ps(src[5] + frame);
+            __m128 low = _mm_unpacklo_ps(c4, c5);
+            __m128 high = _mm_unpackhi_ps(c4, c5);
+
+            interleave_4x4_sse2(dst, src, frame, 0, 6);
+            _mm_storel_pi(reinterpret_cast<__m64*>(dst + (frame * 6) + 4), low);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(dst + ((frame + 1) * 6) + 4), low);
+            _mm_storel_pi(reinterpret_cast<__m64*>(dst + ((frame + 2) * 6) + 4), high);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(dst + ((frame + 3) * 6) + 4), high);
+        }
+
+        const float* tail[6];
+        for (int c = 0; c < 6; ++c)
+        {
+            tail[c] = src[c] + frame;
+        }
+        interleave_scalar(dst + (frame * 6), tail, frames - frame, 6);
+    }
+
+    static void deinterleave6_sse2(float* const* dst, const float* src, int frames)
+    {
+        int frame = 0;
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            __m128 pairs01 = _mm_setzero_ps();
+            __m128 pairs23 = _mm_setzero_ps();
+            pairs01 = _mm_loadl_pi(pairs01, reinterpret_cast<const __m64*>(src + (frame * 6) + 4));
+            pairs01 = _mm_loadh_pi(pairs01, reinterpret_cast<const __m64*>(src + ((frame + 1) * 6) + 4));
+            pairs23 = _mm_loadl_pi(pairs23, reinterpret_cast<const __m64*>(src + ((frame + 2) * 6) + 4));
+            pairs23 = _mm_loadh_pi(pairs23, reinterpret_cast<const __m64*>(src + ((frame + 3) * 6) + 4));
+
+            deinterleave_4x4_sse2(dst, src, frame, 0, 6);
+            _mm_storeu_ps(dst[4] + frame, _mm_shuffle_ps(pairs01, pairs23, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(dst[5] + frame, _mm_shuffle_ps(pairs01, pairs23, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+
+        float* tail[6];
+        for (int c = 0; c < 6; ++c)
+        {
+            tail[c] = dst[c] + frame;
+        }
+        deinterleave_scalar(tail, src + (frame * 6), frames - frame, 6);
+    }
+
+    static void apply_gain_sse2(float* samples, size_t count, float gain)
+    {
+        __m128 gains = _mm_set1_ps(gain);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gains));
+        }
+        apply_gain_scalar(samples + i, count - i, gain);
+    }
+
+    static float dot_product_sse2(const float* a, const float* b, size_t count)
+    {
+        // Two accumulators hide the add latency.
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_product_scalar(a + i, b + i, count - i);
+    }
+
+    static __m128i xorshift_sse2(__m128i state)
+    {
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+        state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+        return _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+    }
+
+    // Turn the top 23 random bits into the mantissa of a float in [1, 2) then shift it to [0, 1).
+    static __m128 random_unit_sse2(__m128i state)
+    {
+        __m128i bits = _mm_or_si128(_mm_srli_epi32(state, 9), _mm_set1_epi32(0x3f800000));
+        return _mm_sub_ps(_mm_castsi128_ps(bits), _mm_set1_ps(1.0f));
+    }
+
+    static void float_to_int16_sse2(int16_t* dst, const float* src, size_t count, DitherState& dither)
+    {
+        __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither.lanes));
+        __m128 scale = _mm_set1_ps(int16Scale);
+        __m128 minimum = _mm_set1_ps(-32768.0f);
+        __m128 maximum = _mm_set1_ps(32767.0f);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128 values[2];
+            for (int half = 0; half < 2; ++half)
+            {
+                state = xorshift_sse2(state);
+                __m128 a = random_unit_sse2(state);
+                state = xorshift_sse2(state);
+                __m128 tpdf = _mm_sub_ps(a, random_unit_sse2(state));
+
+                __m128 value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i + (half * 4)), scale), tpdf);
+                values[half] = _mm_min_ps(maximum, _mm_max_ps(minimum, value));
+            }
+
+            __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(values[0]), _mm_cvtps_epi32(values[1]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither.lanes), state);
+        float_to_int16_scalar(dst + i, src + i, count - i, dither);
+    }
+
+    static const KernelTable sse2Kernels = {
+        "sse2",
+        interleave2_sse2,
+        deinterleave2_sse2,
+        interleave8_sse2,
+        deinterleave8_sse2,
+        apply_gain_sse2,
+        float_to_int16_sse2,
+        dot_product_sse2,
+    };
+#endif
+
+    /////////////////////////////////////
+    // Runtime dispatch
+    /////////////////////////////////////
+
+    static bool cpu_has_avx2()
+    {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // The OS also has to save the upper halves of the ymm registers.
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    static const KernelTable* select_kernels()
+    {
+        const KernelTable* avx2 = get_avx2_kernels();
+        if (avx2 != nullptr && cpu_has_avx2())
+        {
+            return avx2;
+        }
+#if defined(KERNELS_SSE2)
+        return &sse2Kernels;
+#endif
+        return &scalarKernels;
+    }
+
+    static const KernelTable& kernels()
+    {
+        static const KernelTable* table = select_kernels();
+        return *table;
+    }
+
+    void interleave(float* dst, const float* const* src, int frames, int channels)
+    {
+        switch (channels)
+        {
+            case 1:
+                std::memcpy(dst, src[0], frames * sizeof(float));
+                break;
+            case 2:
+                kernels().interleave2(dst, src[0], src[1], frames);
+                break;
+#if defined(KERNELS_SSE2)
+            case 6:
+                interleave6_sse2(dst, src, frames);
+                break;
+#endif
+            case 8:
+                kernels().interleave8(dst, src, frames);
+                break;
+            default:
+                interleave_scalar(dst, src, frames, channels);
+                break;
+        }
+    }
+
+    void deinterleave(float* const* dst, const float* src, int frames, int channels)
+    {
+        switch (channels)
+        {
+            case 1:
+                std::memcpy(dst[0], src, frames * sizeof(float));
+                break;
+            case 2:
+                kernels().deinterleave2(dst[0], dst[1], src, frames);
+                break;
+#if defined(KERNELS_SSE2)
+            case 6:
+                deinterleave6_sse2(dst, src, frames);
+                break;
+#endif
+            case 8:
+                kernels().deinterleave8(dst, src, frames);
+                break;
+            default:
+                deinterleave_scalar(dst, src, frames, channels);
+                break;
+        }
+    }
+
+    static inline void map_frame(float* out, int dstChannels, float left, float right)
+    {
+        if (dstChannels == 1)
+        {
+            out[0] = (left + right) * 0.5f;
+        }
+        else
+        {
+            out[0] = left;
+            out[1] = right;
+            std::fill(out + 2, out + dstChannels, 0.0f);
+        }
+    }
+
+    // Changing layout is rare and memory bound, only matching layouts take the vectorized paths.
+    void map_channels(float* dst, int dstChannels, const float* src, int srcChannels, int frames)
+    {
+        if (dstChannels == srcChannels)
+        {
+            std::memcpy(dst, src, static_cast<size_t>(frames) * srcChannels * sizeof(float));
+            return;
+        }
+
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            const float* in = src + (frame * srcChannels);
+            map_frame(dst + (frame * dstChannels), dstChannels, in[0], in[srcChannels - 1]);
+        }
+    }
+
+    void interleave_mapped(float* dst, int dstChannels, const float* const* src, int srcChannels, int frames)
+    {
+        if (dstChannels == srcChannels)
+        {
+            interleave(dst, src, frames, srcChannels);
+            return;
+        }
+
+        const float* left = src[0];
+        const float* right = src[srcChannels - 1];
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            map_frame(dst + (frame * dstChannels), dstChannels, left[frame], right[frame]);
+        }
+    }
+
+    void apply_gain(float* samples, size_t count, float gain)
+    {
+        kernels().apply_gain(samples, count, gain);
+    }
+
+    void float_to_int16(int16_t* dst, const float* src, size_t count, DitherState& dither)
+    {
+        kernels().float_to_int16(dst, src, count, dither);
+    }
+
+    float dot_product(const float* a, const float* b, size_t count)
+    {
+        return kernels().dot_product(a, b, count);
+    }
+
+    const char* get_kernel_isa()
+    {
+        return kernels().name;
+    }
+}
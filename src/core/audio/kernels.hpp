@@ -0,0 +1,58 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Sample format conversion and analysis kernels shared by the decoders, outputs and analyzers.
+// Each kernel has a scalar version plus SSE2 and AVX2 versions, the fastest one the cpu supports is picked at runtime.
+namespace ORCore
+{
+    // Per lane random state for dithering, only touched by the thread doing the conversion.
+    struct DitherState
+    {
+        uint32_t lanes[8];
+    };
+
+    DitherState make_dither_state(uint32_t seed);
+
+    // Planar to interleaved and back, 1, 2, 6 and 8 channels have vectorized versions.
+    void interleave(float* dst, const float* const* src, int frames, int channels);
+    void deinterleave(float* const* dst, const float* src, int frames, int channels);
+
+    // Copy frames between channel layouts, matching layouts are copied as is.
+    // Otherwise the first and last source channels go to the first two outputs, or are averaged
+    // for mono output, and any other outputs are silent. Mono sources end up on both sides.
+    void map_channels(float* dst, int dstChannels, const float* src, int srcChannels, int frames);
+
+    // interleave with the same channel mapping as map_channels when the layouts differ.
+    void interleave_mapped(float* dst, int dstChannels, const float* const* src, int srcChannels, int frames);
+
+    void apply_gain(float* samples, size_t count, float gain);
+
+    // Convert to 16 bit with triangular dither of one least significant bit, out of range samples are clipped.
+    void float_to_int16(int16_t* dst, const float* src, size_t count, DitherState& dither);
+
+    // Sum of a[i] * b[i], the inner loop of autocorrelation.
+    float dot_product(const float* a, const float* b, size_t count);
+
+    // Name of the instruction set in use, for logging and benchmarks.
+    const char* get_kernel_isa();
+
+    // One table per instruction set, kernels missing from a table fall back to the SSE2/scalar versions.
+    struct KernelTable
+    {
+        const char* name;
+        void (*interleave2)(float* dst, const float* left, const float* right, int frames);
+        void (*deinterleave2)(float* left, float* right, const float* src, int frames);
+        void (*interleave8)(float* dst, const float* const* src, int frames);
+        void (*deinterleave8)(float* const* dst, const float* src, int frames);
+        void (*apply_gain)(float* samples, size_t count, float gain);
+        void (*float_to_int16)(int16_t* dst, const float* src, size_t count, DitherState& dither);
+        float (*dot_product)(const float* a, const float* b, size_t count);
+    };
+
+    // Defined in kernels_avx2.cpp, returns nullptr if that file was not built with AVX2 enabled.
+    const KernelTable* get_avx2_kernels();
+}
@@ -0,0 +1,264 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+// This file is built with AVX2 code generation enabled, nothing in here may run
+// unless the cpu check in kernels.cpp has passed.
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+
+#include "kernels.hpp"
+
+namespace ORCore
+{
+#if defined(__AVX2__)
+    static void interleave2_avx2(float* dst, const float* left, const float* right, int frames)
+    {
+        int frame = 0;
+        for (; frame + 8 <= frames; frame += 8)
+        {
+            __m256 l = _mm256_loadu_ps(left + frame);
+            __m256 r = _mm256_loadu_ps(right + frame);
+            __m256 low = _mm256_unpacklo_ps(l, r);
+            __m256 high = _mm256_unpackhi_ps(l, r);
+            _mm256_storeu_ps(dst + (frame * 2), _mm256_permute2f128_ps(low, high, 0x20));
+            _mm256_storeu_ps(dst + (frame * 2) + 8, _mm256_permute2f128_ps(low, high, 0x31));
+        }
+
+        for (; frame < frames; ++frame)
+        {
+            dst[frame * 2] = left[frame];
+            dst[(frame * 2) + 1] = right[frame];
+        }
+    }
+
+    static void deinterleave2_avx2(float* left, float* right, const float* src, int frames)
+    {
+        int frame = 0;
+        for (; frame + 8 <= frames; frame += 8)
+        {
+            __m256 a = _mm256_loadu_ps(src + (frame * 2));
+            __m256 b = _mm256_loadu_ps(src + (frame * 2) + 8);
+            __m256 low = _mm256_permute2f128_ps(a, b, 0x20);
+            __m256 high = _mm256_permute2f128_ps(a, b, 0x31);
+            _mm256_storeu_ps(left + frame, _mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm256_storeu_ps(right + frame, _mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+
+        for (; frame < frames; ++frame)
+        {
+            left[frame] = src[frame * 2];
+            right[frame] = src[(frame * 2) + 1];
+        }
+    }
+
+    // In place transpose of an 8x8 block held in rows.
+    static void transpose_8x8(__m256* rows)
+    {
+        __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+        __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+        __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+        __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+        __m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+        __m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+        __m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+        __m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+        __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        rows[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+        rows[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+        rows[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+        rows[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+        rows[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+        rows[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+        rows[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+        rows[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+    }
+
+    static void interleave8_avx2(float* dst, const float* const* src, int frames)
+    {
+        int frame = 0;
+        __m256 rows[8];
+        for (; frame + 8 <= frames; frame += 8)
+        {
+            for (int c = 0; c < 8; ++c)
+            {
+                rows[c] = _mm256_loadu_ps(src[c] + frame);
+            }
+            transpose_8x8(rows);
+            for (int i = 0; i < 8; ++i)
+            {
+                _mm256_storeu_ps(dst + ((frame + i) * 8), rows[i]);
+            }
+        }
+
+        for (; frame < frames; ++frame)
+        {
+            for (int c = 0; c < 8; ++c)
+            {
+                dst[(frame * 8) + c] = src[c][frame];
+            }
+        }
+    }
+
+    static void deinterleave8_avx2(float* const* dst, const float* src, int frames)
+    {
+        int frame = 0;
+        __m256 rows[8];
+        for (; frame + 8 <= frames; frame += 8)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                rows[i] = _mm256_loadu_ps(src + ((frame + i) * 8));
+            }
+            transpose_8x8(rows);
+            for (int c = 0; c < 8; ++c)
+            {
+                _mm256_storeu_ps(dst[c] + frame, rows[c]);
+            }
+        }
+
+        for (; frame < frames; ++frame)
+        {
+            for (int c = 0; c < 8; ++c)
+            {
+                dst[c][frame] = src[(frame * 8) + c];
+            }
+        }
+    }
+
+    static void apply_gain_avx2(float* samples, size_t count, float gain)
+    {
+        __m256 gains = _mm256_set1_ps(gain);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), gains));
+        }
+
+        for (; i < count; ++i)
+        {
+            samples[i] *= gain;
+        }
+    }
+
+    static float dot_product_avx2(const float* a, const float* b, size_t count)
+    {
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+        }
+
+        __m256 sum = _mm256_add_ps(sum0, sum1);
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        float lanes[4];
+        _mm_storeu_ps(lanes, half);
+        float total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+        for (; i < count; ++i)
+        {
+            total += a[i] * b[i];
+        }
+        return total;
+    }
+
+    static __m256i xorshift_avx2(__m256i state)
+    {
+        state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+        state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+        return _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+    }
+
+    static __m256 random_unit_avx2(__m256i state)
+    {
+        __m256i bits = _mm256_or_si256(_mm256_srli_epi32(state, 9), _mm256_set1_epi32(0x3f800000));
+        return _mm256_sub_ps(_mm256_castsi256_ps(bits), _mm256_set1_ps(1.0f));
+    }
+
+    static void float_to_int16_avx2(int16_t* dst, const float* src, size_t count, DitherState& dither)
+    {
+        __m256i state = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dither.lanes));
+        __m256 scale = _mm256_set1_ps(32767.0f);
+        __m256 minimum = _mm256_set1_ps(-32768.0f);
+        __m256 maximum = _mm256_set1_ps(32767.0f);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i converted[2];
+            for (int half = 0; half < 2; ++half)
+            {
+                state = xorshift_avx2(state);
+                __m256 a = random_unit_avx2(state);
+                state = xorshift_avx2(state);
+                __m256 tpdf = _mm256_sub_ps(a, random_unit_avx2(state));
+
+                __m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + (half * 8)), scale), tpdf);
+                value = _mm256_min_ps(maximum, _mm256_max_ps(minimum, value));
+                converted[half] = _mm256_cvtps_epi32(value);
+            }
+
+            // packs works within each 128 bit lane, put the 64 bit quarters back in order afterwards.
+            __m256i packed = _mm256_packs_epi32(converted[0], converted[1]);
+            packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dither.lanes), state);
+
+        uint32_t& lane = dither.lanes[0];
+        for (; i < count; ++i)
+        {
+            lane ^= lane << 13;
+            lane ^= lane >> 17;
+            lane ^= lane << 5;
+            float a = (lane >> 9) * (1.0f / 8388608.0f);
+            lane ^= lane << 13;
+            lane ^= lane >> 17;
+            lane ^= lane << 5;
+            float b = (lane >> 9) * (1.0f / 8388608.0f);
+
+            float value = (src[i] * 32767.0f) + (a - b);
+            value = std::max(-32768.0f, std::min(32767.0f, value));
+            dst[i] = static_cast<int16_t>(std::lrint(value));
+        }
+    }
+
+    static const KernelTable avx2Kernels = {
+        "avx2",
+        interleave2_avx2,
+        deinterleave2_avx2,
+        interleave8_avx2,
+        deinterleave8_avx2,
+        apply_gain_avx2,
+        float_to_int16_avx2,
+        dot_product_avx2,
+    };
+
+    const KernelTable* get_avx2_kernels()
+    {
+        return &avx2Kernels;
+    }
+#else
+    const KernelTable* get_avx2_kernels()
+    {
+        return nullptr;
+    }
+#endif
+}
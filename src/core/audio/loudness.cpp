@@ -0,0 +1,559 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include "config.hpp"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define LOUDNESS_SSE2
+#   include <emmintrin.h>
+#endif
+
+#include "loudness.hpp"
+#include "decoderregistry.hpp"
+#include "filesystem.hpp"
+
+namespace ORCore
+{
+    const double pi = 3.14159265358979323846;
+
+    // Loudness of a block is -0.691 + 10 * log10(power), the offset cancels the K-weighting gain at 1kHz.
+    const double loudnessOffset = -0.691;
+    const double absoluteGate = -70.0;
+    const double relativeGate = -10.0;
+
+    // True peak oversampling filter, 4 phases of 12 taps.
+    const int oversampling = 4;
+    const int phaseTaps = 12;
+    const int peakTaps = oversampling * phaseTaps;
+
+    static double power_to_loudness(double power)
+    {
+        return loudnessOffset + (10.0 * std::log10(power));
+    }
+
+    static double loudness_to_power(double loudness)
+    {
+        return std::pow(10.0, (loudness - loudnessOffset) / 10.0);
+    }
+
+    float loudness_gain(const LoudnessInfo& info, double targetLufs, double maxPeak)
+    {
+        if (!std::isfinite(info.integrated))
+        {
+            return 1.0f;
+        }
+
+        double gain = targetLufs - info.integrated;
+        if (std::isfinite(info.truePeak))
+        {
+            gain = std::min(gain, maxPeak - info.truePeak);
+        }
+        return static_cast<float>(std::pow(10.0, gain / 20.0));
+    }
+
+    LoudnessMeter::LoudnessMeter(StreamFormat format)
+    : m_format(format),
+    m_subblockFrames(std::max(1, format.sampleRate / 10)),
+    m_subblockPosition(0),
+    m_state(static_cast<size_t>(format.channels) * 4, 0.0),
+    m_weights(format.channels, 1.0),
+    m_sums(format.channels, 0.0),
+    m_subblocks{0.0, 0.0, 0.0, 0.0},
+    m_subblockCount(0),
+    m_historyPosition(0)
+    {
+        double rate = static_cast<double>(format.sampleRate);
+
+        // K-weighting pre filter, a high shelf modelling the acoustic effect of the head.
+        double f0 = 1681.974450955533;
+        double gain = 3.999843853973347;
+        double q = 0.7071752369554196;
+        double k = std::tan(pi * f0 / rate);
+        double vh = std::pow(10.0, gain / 20.0);
+        double vb = std::pow(vh, 0.4996667741545416);
+        double a0 = 1.0 + (k / q) + (k * k);
+        m_shelf[0] = (vh + (vb * k / q) + (k * k)) / a0;
+        m_shelf[1] = 2.0 * ((k * k) - vh) / a0;
+        m_shelf[2] = (vh - (vb * k / q) + (k * k)) / a0;
+        m_shelf[3] = 2.0 * ((k * k) - 1.0) / a0;
+        m_shelf[4] = (1.0 - (k / q) + (k * k)) / a0;
+
+        // RLB weighting, a high pass around 38Hz.
+        f0 = 38.13547087602444;
+        q = 0.5003270373238773;
+        k = std::tan(pi * f0 / rate);
+        a0 = 1.0 + (k / q) + (k * k);
+        m_highpass[0] = 1.0;
+        m_highpass[1] = -2.0;
+        m_highpass[2] = 1.0;
+        m_highpass[3] = 2.0 * ((k * k) - 1.0) / a0;
+        m_highpass[4] = (1.0 - (k / q) + (k * k)) / a0;
+
+        // The LFE channel of 5.1 is not measured and the surrounds are weighted +1.5dB.
+        if (format.channels == 6)
+        {
+            m_weights[3] = 0.0;
+            m_weights[4] = 1.41;
+            m_weights[5] = 1.41;
+        }
+
+        // Blackman windowed sinc interpolating between the original samples.
+        // Laid out so taps [4k, 4k + 4) are the kth tap of every phase, one vector per input sample.
+        m_taps = make_aligned_floats(peakTaps);
+        for (int n = 0; n < peakTaps; ++n)
+        {
+            double x = (n - ((peakTaps - 1) / 2.0)) / oversampling;
+            double sinc = x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+            double window = 0.42 - (0.5 * std::cos(2.0 * pi * (n + 0.5) / peakTaps)) +
+                            (0.08 * std::cos(4.0 * pi * (n + 0.5) / peakTaps));
+            m_taps[n] = static_cast<float>(sinc * window);
+        }
+
+        m_history = make_aligned_floats(static_cast<size_t>(format.channels) * phaseTaps * 2);
+        m_peaks = make_aligned_floats(static_cast<size_t>(format.channels) * oversampling);
+        std::fill(m_history.get(), m_history.get() + (format.channels * phaseTaps * 2), 0.0f);
+        std::fill(m_peaks.get(), m_peaks.get() + (format.channels * oversampling), 0.0f);
+    }
+
+    void LoudnessMeter::process(const float* samples, int frames)
+    {
+        // Split at sub block boundaries so every block only adds to one sub block.
+        while (frames > 0)
+        {
+            int count = std::min(frames, m_subblockFrames - m_subblockPosition);
+            process_block(samples, count);
+
+            samples += count * m_format.channels;
+            frames -= count;
+            m_subblockPosition += count;
+            if (m_subblockPosition == m_subblockFrames)
+            {
+                end_subblock();
+            }
+        }
+    }
+
+    void LoudnessMeter::process_block(const float* samples, int frames)
+    {
+        int channels = m_format.channels;
+        int c = 0;
+
+        // K-weighting runs in double precision, the 38Hz high pass has poles too close to the unit circle for floats.
+        // The filters are recursive so SSE2 filters two channels at once instead of several samples.
+#if defined(LOUDNESS_SSE2)
+        const __m128d sb0 = _mm_set1_pd(m_shelf[0]), sb1 = _mm_set1_pd(m_shelf[1]), sb2 = _mm_set1_pd(m_shelf[2]);
+        const __m128d sa1 = _mm_set1_pd(m_shelf[3]), sa2 = _mm_set1_pd(m_shelf[4]);
+        const __m128d ha1 = _mm_set1_pd(m_highpass[3]), ha2 = _mm_set1_pd(m_highpass[4]);
+        const __m128d minusTwo = _mm_set1_pd(-2.0);
+
+        for (; c + 1 < channels; c += 2)
+        {
+            double* left = &m_state[c * 4];
+            double* right = &m_state[(c + 1) * 4];
+            __m128d z1 = _mm_set_pd(right[0], left[0]);
+            __m128d z2 = _mm_set_pd(right[1], left[1]);
+            __m128d z3 = _mm_set_pd(right[2], left[2]);
+            __m128d z4 = _mm_set_pd(right[3], left[3]);
+            __m128d sum = _mm_setzero_pd();
+
+            for (int i = 0; i < frames; ++i)
+            {
+                const float* frame = samples + (i * channels) + c;
+                __m128d x = _mm_set_pd(frame[1], frame[0]);
+
+                __m128d y = _mm_add_pd(_mm_mul_pd(sb0, x), z1);
+                z1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(sb1, x), _mm_mul_pd(sa1, y)), z2);
+                z2 = _mm_sub_pd(_mm_mul_pd(sb2, x), _mm_mul_pd(sa2, y));
+
+                // The high pass numerator is 1, -2, 1.
+                __m128d out = _mm_add_pd(y, z3);
+                z3 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(minusTwo, y), _mm_mul_pd(ha1, out)), z4);
+                z4 = _mm_sub_pd(y, _mm_mul_pd(ha2, out));
+
+                sum = _mm_add_pd(sum, _mm_mul_pd(out, out));
+            }
+
+            double z[2];
+            _mm_storeu_pd(z, z1); left[0] = z[0]; right[0] = z[1];
+            _mm_storeu_pd(z, z2); left[1] = z[0]; right[1] = z[1];
+            _mm_storeu_pd(z, z3); left[2] = z[0]; right[2] = z[1];
+            _mm_storeu_pd(z, z4); left[3] = z[0]; right[3] = z[1];
+            _mm_storeu_pd(z, sum);
+            m_sums[c] += z[0];
+            m_sums[c + 1] += z[1];
+        }
+#endif
+        for (; c < channels; ++c)
+        {
+            double* z = &m_state[c * 4];
+            double sum = 0.0;
+            for (int i = 0; i < frames; ++i)
+            {
+                double x = samples[(i * channels) + c];
+                double y = (m_shelf[0] * x) + z[0];
+                z[0] = (m_shelf[1] * x) - (m_shelf[3] * y) + z[1];
+                z[1] = (m_shelf[2] * x) - (m_shelf[4] * y);
+
+                double out = y + z[2];
+                z[2] = (-2.0 * y) - (m_highpass[3] * out) + z[3];
+                z[3] = y - (m_highpass[4] * out);
+                sum += out * out;
+            }
+            m_sums[c] += sum;
+        }
+
+        // True peak, every input sample produces all four phases of the oversampled signal in one vector.
+        float* history = m_history.get();
+        float* peaks = m_peaks.get();
+        const float* taps = m_taps.get();
+        for (int i = 0; i < frames; ++i)
+        {
+            m_historyPosition = m_historyPosition == 0 ? phaseTaps - 1 : m_historyPosition - 1;
+            for (c = 0; c < channels; ++c)
+            {
+                // Newest sample first, stored twice so the window never wraps.
+                float* window = history + (c * phaseTaps * 2);
+                float sample = samples[(i * channels) + c];
+                window[m_historyPosition] = sample;
+                window[m_historyPosition + phaseTaps] = sample;
+                window += m_historyPosition;
+#if defined(LOUDNESS_SSE2)
+                __m128 acc = _mm_setzero_ps();
+                for (int k = 0; k < phaseTaps; ++k)
+                {
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(taps + (k * oversampling)), _mm_set1_ps(window[k])));
+                }
+                __m128 absolute = _mm_andnot_ps(_mm_set1_ps(-0.0f), acc);
+                float* peak = peaks + (c * oversampling);
+                _mm_store_ps(peak, _mm_max_ps(_mm_load_ps(peak), absolute));
+#else
+                for (int p = 0; p < oversampling; ++p)
+                {
+                    float acc = 0.0f;
+                    for (int k = 0; k < phaseTaps; ++k)
+                    {
+                        acc += taps[(k * oversampling) + p] * window[k];
+                    }
+                    float* peak = peaks + (c * oversampling) + p;
+                    *peak = std::max(*peak, std::fabs(acc));
+                }
+#endif
+            }
+        }
+    }
+
+    void LoudnessMeter::end_subblock()
+    {
+        double power = 0.0;
+        for (int c = 0; c < m_format.channels; ++c)
+        {
+            power += m_weights[c] * (m_sums[c] / m_subblockFrames);
+            m_sums[c] = 0.0;
+        }
+        m_subblockPosition = 0;
+
+        m_subblocks[m_subblockCount % 4] = power;
+        m_subblockCount++;
+
+        // Gating blocks are 400ms long and start every 100ms.
+        if (m_subblockCount >= 4)
+        {
+            m_blocks.push_back((m_subblocks[0] + m_subblocks[1] + m_subblocks[2] + m_subblocks[3]) / 4.0);
+        }
+    }
+
+    LoudnessInfo LoudnessMeter::get_info()
+    {
+        LoudnessInfo info;
+        info.integrated = -std::numeric_limits<double>::infinity();
+
+        double gate = loudness_to_power(absoluteGate);
+        double sum = 0.0;
+        size_t count = 0;
+        for (double block : m_blocks)
+        {
+            if (block > gate)
+            {
+                sum += block;
+                count++;
+            }
+        }
+
+        if (count > 0)
+        {
+            gate = std::max(gate, (sum / count) * std::pow(10.0, relativeGate / 10.0));
+            sum = 0.0;
+            count = 0;
+            for (double block : m_blocks)
+            {
+                if (block > gate)
+                {
+                    sum += block;
+                    count++;
+                }
+            }
+            if (count > 0)
+            {
+                info.integrated = power_to_loudness(sum / count);
+            }
+        }
+
+        float peak = 0.0f;
+        for (int i = 0; i < m_format.channels * oversampling; ++i)
+        {
+            peak = std::max(peak, m_peaks[i]);
+        }
+        info.truePeak = peak > 0.0f ? 20.0 * std::log10(peak) : -std::numeric_limits<double>::infinity();
+        return info;
+    }
+
+    LoudnessOutput::LoudnessOutput(int blockFrames)
+    : OfflineOutput(blockFrames),
+    m_info({-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()})
+    {
+    }
+
+    LoudnessOutput::~LoudnessOutput()
+    {
+        stop();
+    }
+
+    LoudnessInfo LoudnessOutput::get_info()
+    {
+        return m_info;
+    }
+
+    bool LoudnessOutput::open(StreamFormat format)
+    {
+        m_meter = std::make_unique<LoudnessMeter>(format);
+        return true;
+    }
+
+    void LoudnessOutput::write(Buffer& buffer)
+    {
+        m_meter->process(buffer, buffer.get_info().frames);
+    }
+
+    void LoudnessOutput::close()
+    {
+        m_info = m_meter->get_info();
+        m_meter.reset();
+    }
+
+    // Cache files only hold the measurement, the gain is worked out when loading so the target can change.
+    struct LoudnessCacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t fileCount;
+        int64_t sourceSize;
+        int64_t sourceTime;
+        double integrated;
+        double truePeak;
+    };
+
+    static const char loudnessCacheMagic[4] = {'O', 'R', 'L', 'N'};
+    static const uint32_t loudnessCacheVersion = 2;
+
+    // Total size of the files, used to notice that the songs audio was replaced.
+    static int64_t files_size(const std::vector<std::string>& filenames)
+    {
+        int64_t size = 0;
+        for (auto &filename : filenames)
+        {
+            std::ifstream file(filename, std::ios_base::ate | std::ios_base::binary);
+            if (!file)
+            {
+                return -1;
+            }
+            size += static_cast<int64_t>(file.tellg());
+        }
+        return size;
+    }
+
+    // Newest modification time of the files, so re-exported audio of the same size is noticed too.
+    static int64_t files_time(const std::vector<std::string>& filenames)
+    {
+        int64_t time = -1;
+        for (auto &filename : filenames)
+        {
+            time = std::max(time, get_modified_time(filename));
+        }
+        return time;
+    }
+
+    LoudnessJob::LoudnessJob(std::vector<std::string> filenames, std::string cacheFilename, DecoderPool* pool)
+    : m_filenames(filenames),
+    m_cacheFilename(cacheFilename),
+    m_pool(pool),
+    m_cancel(false),
+    m_done(false)
+    {
+        if (filenames.empty())
+        {
+            throw std::runtime_error("Loudness: No files to analyze.");
+        }
+
+        // The mix is always stereo like the song's buses, the mixer maps any other stem layout.
+        StreamFormat format = {0, 2};
+        for (auto &filename : filenames)
+        {
+            m_decoders.push_back(get_decoder_registry().open(filename));
+            format.sampleRate = std::max(format.sampleRate, m_decoders.back()->get_format().sampleRate);
+        }
+
+        // Mixers never pause, so render for as long as the longest file.
+        int64_t length = 0;
+        for (auto &decoder : m_decoders)
+        {
+            length = std::max(length, static_cast<int64_t>(std::ceil(decoder->get_length() * format.sampleRate)));
+        }
+
+        m_mixer.set_format(format);
+        m_mixer.start(4096);
+        for (auto &decoder : m_decoders)
+        {
+            m_mixer.add_source(decoder.get());
+        }
+
+        m_output.set_block_size(4096);
+        m_output.set_source(&m_mixer);
+        m_output.set_length(length);
+
+        if (m_pool != nullptr)
+        {
+            m_pool->add(this);
+        }
+        else
+        {
+            m_thread = std::thread(&LoudnessJob::analyze_loop, this);
+        }
+    }
+
+    LoudnessJob::~LoudnessJob()
+    {
+        m_cancel.store(true, std::memory_order_release);
+        if (m_pool != nullptr)
+        {
+            m_pool->remove(this);
+        }
+        else if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    bool LoudnessJob::decode_step()
+    {
+        if (m_done.load(std::memory_order_relaxed) || m_cancel.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        if (m_output.render_step())
+        {
+            return true;
+        }
+
+        if (!m_cacheFilename.empty())
+        {
+            write_cache();
+        }
+        m_done.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void LoudnessJob::analyze_loop()
+    {
+        while (decode_step())
+        {
+        }
+    }
+
+    bool LoudnessJob::is_done()
+    {
+        return m_done.load(std::memory_order_acquire);
+    }
+
+    LoudnessInfo LoudnessJob::get_info()
+    {
+        return m_output.get_info();
+    }
+
+    bool LoudnessJob::load_cache(std::string cacheFilename, const std::vector<std::string>& filenames, LoudnessInfo& info)
+    {
+        std::ifstream file(cacheFilename, std::ios_base::binary);
+        if (!file)
+        {
+            return false;
+        }
+
+        LoudnessCacheHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file ||
+            std::memcmp(header.magic, loudnessCacheMagic, sizeof(loudnessCacheMagic)) != 0 ||
+            header.version != loudnessCacheVersion ||
+            header.fileCount != filenames.size() ||
+            header.sourceSize != files_size(filenames) ||
+            header.sourceTime != files_time(filenames))
+        {
+            return false;
+        }
+
+        info.integrated = header.integrated;
+        info.truePeak = header.truePeak;
+        return true;
+    }
+
+    void LoudnessJob::write_cache()
+    {
+        auto logger = spdlog::get("default");
+        LoudnessInfo info = m_output.get_info();
+
+        size_t pos = m_cacheFilename.rfind(PATH_SEP);
+        if (pos != std::string::npos)
+        {
+            create_path(m_cacheFilename.substr(0, pos));
+        }
+
+        LoudnessCacheHeader header;
+        std::memcpy(header.magic, loudnessCacheMagic, sizeof(loudnessCacheMagic));
+        header.version = loudnessCacheVersion;
+        header.fileCount = static_cast<uint32_t>(m_filenames.size());
+        header.sourceSize = files_size(m_filenames);
+        header.sourceTime = files_time(m_filenames);
+        header.integrated = info.integrated;
+        header.truePeak = info.truePeak;
+
+        // Write to a temp file first so a partially written cache is never loaded.
+        std::string tempFilename = m_cacheFilename + ".tmp";
+        std::ofstream file(tempFilename, std::ios_base::binary | std::ios_base::trunc);
+        if (!file)
+        {
+            if (logger)
+            {
+                logger->warn("Failed to write loudness cache {}", m_cacheFilename);
+            }
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.close();
+
+        std::remove(m_cacheFilename.c_str());
+        std::rename(tempFilename.c_str(), m_cacheFilename.c_str());
+
+        if (logger)
+        {
+            logger->debug("Measured {:.1f} LUFS {:.1f} dBTP", info.integrated, info.truePeak);
+        }
+    }
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+#include "mixer.hpp"
+#include "offlineoutput.hpp"
+#include "decodersource.hpp"
+#include "decoderpool.hpp"
+
+namespace ORCore
+{
+    struct LoudnessInfo
+    {
+        double integrated; // LUFS, -inf for silence
+        double truePeak;   // dBTP
+    };
+
+    // Linear gain that brings audio with the given loudness to targetLufs without its true peak going over maxPeak dBTP.
+    float loudness_gain(const LoudnessInfo& info, double targetLufs, double maxPeak);
+
+    // Integrated loudness and true peak as specified by ITU-R BS.1770-4 and EBU R128.
+    // Samples are K-weighted, measured in 400ms blocks overlapping by 75% and gated at -70 LUFS and
+    // 10 LU below the ungated loudness. True peak is the sample peak of a 4x oversampled signal.
+    class LoudnessMeter
+    {
+    public:
+        LoudnessMeter(StreamFormat format);
+
+        // Measure interleaved samples in the meters format.
+        void process(const float* samples, int frames);
+
+        LoudnessInfo get_info();
+
+    private:
+        void process_block(const float* samples, int frames);
+        void end_subblock();
+
+        StreamFormat m_format;
+        int m_subblockFrames;
+        int m_subblockPosition;
+
+        // Biquad coefficients of the two K-weighting stages, b0 b1 b2 a1 a2.
+        double m_shelf[5];
+        double m_highpass[5];
+
+        // Per channel filter state, four values per channel.
+        std::vector<double> m_state;
+        std::vector<double> m_weights;
+        std::vector<double> m_sums;
+
+        // Mean square of the last four 100ms sub blocks, a gating block is their average.
+        double m_subblocks[4];
+        int64_t m_subblockCount;
+        std::vector<double> m_blocks;
+
+        // True peak oversampling, the last taps samples of every channel stored twice so they can be read contiguously.
+        AlignedFloats m_taps;
+        AlignedFloats m_history;
+        int m_historyPosition;
+        AlignedFloats m_peaks;
+    };
+
+    // Null consumer that measures everything it is given.
+    class LoudnessOutput: public OfflineOutput
+    {
+    public:
+        LoudnessOutput(int blockFrames = 4096);
+        ~LoudnessOutput();
+
+        // Only valid after rendering finished.
+        LoudnessInfo get_info();
+
+    protected:
+        bool open(StreamFormat format);
+        void write(Buffer& buffer);
+        void close();
+
+    private:
+        std::unique_ptr<LoudnessMeter> m_meter;
+        LoudnessInfo m_info;
+    };
+
+    // Measures the mix of a set of audio files faster than realtime, one block per step.
+    // Files are decoded through the DecoderRegistry and mixed like a song would be, then rendered into a LoudnessOutput.
+    // The result can be written to a cache file which is validated against the source files when loaded.
+    // Analysis runs on its own thread unless a pool is given.
+    class LoudnessJob: public DecodeTask
+    {
+    public:
+        // Throws std::runtime_error if a file can't be opened.
+        LoudnessJob(std::vector<std::string> filenames, std::string cacheFilename = "", DecoderPool* pool = nullptr);
+        ~LoudnessJob();
+
+        bool decode_step();
+
+        bool is_done();
+
+        // Only valid once is_done() returns true.
+        LoudnessInfo get_info();
+
+        // Returns false if the cache file is missing or the files changed since it was written.
+        static bool load_cache(std::string cacheFilename, const std::vector<std::string>& filenames, LoudnessInfo& info);
+
+    private:
+        void analyze_loop();
+        void write_cache();
+
+        std::vector<std::string> m_filenames;
+        std::string m_cacheFilename;
+        std::vector<std::unique_ptr<DecoderSource>> m_decoders;
+        Mixer m_mixer;
+        LoudnessOutput m_output;
+
+        DecoderPool* m_pool;
+        std::thread m_thread;
+        std::atomic_bool m_cancel;
+        std::atomic_bool m_done;
+    };
+}
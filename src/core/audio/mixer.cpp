@@ -1,48 +1,403 @@
 // Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
 // See LICENSE in the project root for license information.
 
-#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   define MIXER_SSE
+#   include <xmmintrin.h>
+#endif
+
 #include "mixer.hpp"
 
 namespace ORCore
 {
+    // Pulls are split into blocks of this many frames if start() was never called.
+    const int defaultMaxFrames = 1024;
+
+    // Largest channel count the scratch buffer is sized for.
+    const int maxChannels = 8;
+
+    // Add src to dst applying a left/right gain that ramps linearly across the block.
+    static void mix_add_stereo(float* dst, const float* src, int frames,
+                               float left, float right, float leftEnd, float rightEnd)
+    {
+        float leftStep = (leftEnd - left) / frames;
+        float rightStep = (rightEnd - right) / frames;
+        int frame = 0;
+
+#if defined(MIXER_SSE)
+        // Two interleaved stereo frames per vector.
+        __m128 gain = _mm_setr_ps(left, right, left + leftStep, right + rightStep);
+        __m128 step = _mm_setr_ps(leftStep * 2.0f, rightStep * 2.0f, leftStep * 2.0f, rightStep * 2.0f);
+
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            __m128 a = _mm_loadu_ps(src + (frame * 2));
+            __m128 b = _mm_loadu_ps(src + (frame * 2) + 4);
+            __m128 outA = _mm_loadu_ps(dst + (frame * 2));
+            __m128 outB = _mm_loadu_ps(dst + (frame * 2) + 4);
+
+            outA = _mm_add_ps(outA, _mm_mul_ps(a, gain));
+            gain = _mm_add_ps(gain, step);
+            outB = _mm_add_ps(outB, _mm_mul_ps(b, gain));
+            gain = _mm_add_ps(gain, step);
+
+            _mm_storeu_ps(dst + (frame * 2), outA);
+            _mm_storeu_ps(dst + (frame * 2) + 4, outB);
+        }
+#endif
+
+        for (; frame < frames; ++frame)
+        {
+            dst[frame * 2] += src[frame * 2] * (left + (leftStep * frame));
+            dst[(frame * 2) + 1] += src[(frame * 2) + 1] * (right + (rightStep * frame));
+        }
+    }
+
+    // Add src to dst applying a single ramped gain to every channel.
+    static void mix_add(float* dst, const float* src, int frames, int channels, float gain, float gainEnd)
+    {
+        float gainStep = (gainEnd - gain) / frames;
+        int frame = 0;
+
+#if defined(MIXER_SSE)
+        if (channels == 1)
+        {
+            __m128 gains = _mm_setr_ps(gain, gain + gainStep, gain + (gainStep * 2.0f), gain + (gainStep * 3.0f));
+            __m128 step = _mm_set1_ps(gainStep * 4.0f);
+
+            for (; frame + 4 <= frames; frame += 4)
+            {
+                __m128 in = _mm_loadu_ps(src + frame);
+                __m128 out = _mm_loadu_ps(dst + frame);
+                _mm_storeu_ps(dst + frame, _mm_add_ps(out, _mm_mul_ps(in, gains)));
+                gains = _mm_add_ps(gains, step);
+            }
+        }
+#endif
+
+        for (; frame < frames; ++frame)
+        {
+            float frameGain = gain + (gainStep * frame);
+            for (int c = 0; c < channels; ++c)
+            {
+                dst[(frame * channels) + c] += src[(frame * channels) + c] * frameGain;
+            }
+        }
+    }
+
+    // Balance style pan law, the center position leaves both channels at unity gain.
+    static void pan_gains(float gain, float pan, float& left, float& right)
+    {
+        pan = std::max(-1.0f, std::min(1.0f, pan));
+        left = gain * std::min(1.0f, 1.0f - pan);
+        right = gain * std::min(1.0f, 1.0f + pan);
+    }
+
+    Mixer::Mixer()
+    : m_inputList(std::make_unique<MixerInputList>()),
+    m_pulling(false),
+    m_pullCount(0),
+    m_maxFrames(0),
+    m_format({0, 0}),
+    m_paused(false),
+    m_framePosition(0),
+    m_commands(nullptr)
+    {
+        m_activeList.store(m_inputList.get());
+        start(defaultMaxFrames);
+    }
+
+    void Mixer::start(int maxFrames)
+    {
+        if (maxFrames > m_maxFrames)
+        {
+            m_scratch = make_aligned_floats(static_cast<size_t>(maxFrames) * maxChannels);
+            m_maxFrames = maxFrames;
+        }
+    }
+
     bool Mixer::add_source(Stream* stream)
     {
-        m_streams.push_back(stream);
+        auto input = std::make_unique<MixerInput>();
+        input->source = stream;
+        input->gain.store(1.0f, std::memory_order_relaxed);
+        input->pan.store(0.0f, std::memory_order_relaxed);
+        input->currentLeft = 1.0f;
+        input->currentRight = 1.0f;
+
+        if (m_format.sampleRate == 0)
+        {
+            m_format = stream->get_format();
+        }
+        connect_input(input.get());
+
+        m_inputs.push_back(std::move(input));
+        publish_inputs();
+        reclaim();
+        return true;
+    }
+
+    bool Mixer::remove_source(Stream* stream)
+    {
+        auto it = std::find_if(m_inputs.begin(), m_inputs.end(),
+            [stream](const std::unique_ptr<MixerInput>& input) { return input->source == stream; });
+
+        if (it == m_inputs.end())
+        {
+            return false;
+        }
+
+        std::unique_ptr<MixerInput> input = std::move(*it);
+        m_inputs.erase(it);
+        publish_inputs();
+
+        // The caller is free to destroy the stream after this so wait for any pull still using it.
+        retire(nullptr, std::move(input));
+        uint64_t pullCount = m_retired.back().pullCount;
+        while (!pull_finished(pullCount))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        reclaim();
         return true;
     }
 
+    // Build a new list from the owned inputs and swap it in for the audio thread, the old list is retired.
+    void Mixer::publish_inputs()
+    {
+        auto list = std::make_unique<MixerInputList>();
+        list->inputs.reserve(m_inputs.size());
+        for (auto &input : m_inputs)
+        {
+            list->inputs.push_back(input.get());
+        }
+
+        m_activeList.store(list.get());
+        retire(std::move(m_inputList), nullptr);
+        m_inputList = std::move(list);
+    }
+
+    void Mixer::retire(std::unique_ptr<MixerInputList> list, std::unique_ptr<MixerInput> input)
+    {
+        // Read after the new list is published, any pull that started before that bumps the count when it ends.
+        m_retired.push_back({std::move(list), std::move(input), m_pullCount.load()});
+    }
+
+    // True once no pull that could have seen memory retired at pullCount is still running.
+    bool Mixer::pull_finished(uint64_t pullCount)
+    {
+        return !m_pulling.load() || m_pullCount.load() > pullCount;
+    }
+
+    void Mixer::reclaim()
+    {
+        m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+            [this](const RetiredInputs& retired) { return pull_finished(retired.pullCount); }),
+            m_retired.end());
+    }
+
+    void Mixer::set_format(StreamFormat format)
+    {
+        m_format = format;
+        for (auto &input : m_inputs)
+        {
+            connect_input(input.get());
+        }
+    }
+
+    // Pull straight from the source if it matches the mixer format, otherwise go through a resampler
+    // for the rate and a channel mapper for the layout. Sources only ever get pulled in their own layout.
+    void Mixer::connect_input(MixerInput* input)
+    {
+        StreamFormat format = input->source->get_format();
+        input->stream = input->source;
+
+        if (format.sampleRate == m_format.sampleRate)
+        {
+            input->resampler.reset();
+        }
+        else
+        {
+            input->resampler = std::make_unique<Resampler>(m_format.sampleRate);
+            input->resampler->add_source(input->stream);
+            input->stream = input->resampler.get();
+        }
+
+        if (format.channels == m_format.channels)
+        {
+            input->mapper.reset();
+        }
+        else
+        {
+            input->mapper = std::make_unique<ChannelMapper>(m_format.channels);
+            input->mapper->add_source(input->stream);
+            input->stream = input->mapper.get();
+        }
+    }
+
     void Mixer::pull(Buffer& buffer)
     {
-        buffer.clear();// clear output buffer
+        auto info = buffer.get_info();
         float* buf = buffer;
 
-        Buffer tempBuffer(buffer.get_info());
-        tempBuffer.clear();
-        float* tempbuf = tempBuffer;
+        // The list is loaded once so the whole pull sees the same set of inputs.
+        m_pulling.store(true);
+        const MixerInputList* list = m_activeList.load();
 
+        // Mix in chunks that fit within the preallocated scratch memory.
+        int framesMixed = 0;
+        while (framesMixed < info.frames)
+        {
+            int frames = std::min(info.frames - framesMixed, m_maxFrames);
+            if (m_commands != nullptr)
+            {
+                // Apply what is due now and end this piece where the next command starts.
+                int64_t frame = m_framePosition.load(std::memory_order_relaxed);
+                m_commands->dispatch(frame);
+                frames = m_commands->frames_until_next(frame, frames);
+            }
+            mix_block(list, buf + (framesMixed * info.channels), frames, info.channels);
+            framesMixed += frames;
+        }
+
+        m_pullCount.fetch_add(1);
+        m_pulling.store(false);
+    }
+
+    void Mixer::mix_block(const MixerInputList* list, float* output, int frames, int channels)
+    {
+        std::fill(output, output + (frames * channels), 0.0f);
+
+        Buffer scratch(m_scratch.get(), {channels, frames});
+        int64_t blockStart = m_framePosition.load(std::memory_order_relaxed);
 
         // Go through all streams that are not paused and mix them into the output.
-        for (auto &stream : m_streams)
+        for (MixerInput* input : list->inputs)
         {
-            if (!stream->is_paused())
+            if (input->stream->is_paused())
             {
-                stream->pull(tempBuffer);
-                // DO MIXING HERE
-                for (int i = 0; i < buffer.size(); ++i)
+                continue;
+            }
+
+            input->stream->pull(scratch);
+            mix_input(input, output, scratch, frames, channels, input->gain.load(std::memory_order_relaxed));
+        }
+
+        m_framePosition.store(blockStart + frames, std::memory_order_release);
+    }
+
+    // Mix one input ramping from its current gain to the target.
+    void Mixer::mix_input(MixerInput* input, float* output, const float* source, int frames, int channels, float gain)
+    {
+        if (channels == 2)
+        {
+            float left;
+            float right;
+            pan_gains(gain, input->pan.load(std::memory_order_relaxed), left, right);
+            mix_add_stereo(output, source, frames, input->currentLeft, input->currentRight, left, right);
+            input->currentLeft = left;
+            input->currentRight = right;
+        }
+        else
+        {
+            // Panning is only meaningful for stereo output.
+            mix_add(output, source, frames, channels, input->currentLeft, gain);
+            input->currentLeft = gain;
+            input->currentRight = gain;
+        }
+    }
+
+    StreamFormat Mixer::get_format()
+    {
+        if (m_format.sampleRate == 0)
+        {
+            return {44100, 2};
+        }
+        return m_format;
+    }
+
+    bool Mixer::set_gain(Stream* stream, float gain)
+    {
+        MixerInput* input = find_input(stream);
+        if (input == nullptr)
+        {
+            return false;
+        }
+        input->gain.store(gain, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Mixer::set_pan(Stream* stream, float pan)
+    {
+        MixerInput* input = find_input(stream);
+        if (input == nullptr)
+        {
+            return false;
+        }
+        input->pan.store(pan, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Mixer::set_pause(bool paused)
+    {
+        m_paused.store(paused, std::memory_order_release);
+    }
+
+    bool Mixer::is_paused()
+    {
+        return m_paused.load(std::memory_order_acquire);
+    }
+
+    int64_t Mixer::get_frame_position()
+    {
+        return m_framePosition.load(std::memory_order_acquire);
+    }
+
+    void Mixer::set_command_queue(CommandQueue* queue)
+    {
+        m_commands = queue;
+    }
+
+    void Mixer::apply_command(const StreamCommand& command)
+    {
+        switch (command.type)
+        {
+            case CommandType::gain:
+            {
+                // Runs on the audio thread so only the published list may be searched.
+                for (MixerInput* input : m_activeList.load()->inputs)
                 {
-                    buf[i] += tempbuf[i];
+                    if (input->source == command.input)
+                    {
+                        input->gain.store(static_cast<float>(command.value), std::memory_order_relaxed);
+                    }
                 }
+                break;
             }
+            case CommandType::pause:
+                set_pause(true);
+                break;
+            case CommandType::resume:
+                set_pause(false);
+                break;
+            default:
+                break;
         }
     }
 
-    StreamFormat Mixer::get_format()
+    MixerInput* Mixer::find_input(Stream* stream)
     {
-        // the format of the mixer will always be of the first stream that is passed into it.
-        if (m_streams.size() > 0)
+        for (auto &input : m_inputs)
         {
-            return m_streams[0]->get_format();
+            if (input->source == stream)
+            {
+                return input.get();
+            }
         }
+        return nullptr;
     }
-}
\ No newline at end of file
+}
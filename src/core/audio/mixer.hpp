@@ -3,26 +3,121 @@
 
 #pragma once
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
 #include "streams.hpp"
+#include "aligned.hpp"
+#include "resampler.hpp"
+#include "channelmapper.hpp"
+#include "commandqueue.hpp"
 
 namespace ORCore
 {
+    // Per source mixing state.
+    // gain/pan are written by the game thread, the current* values are only touched by the audio thread.
+    // stream is what gets pulled, either the source itself or the resampler and channel mapper wrapping it.
+    struct MixerInput
+    {
+        Stream* source;
+        Stream* stream;
+        std::unique_ptr<Resampler> resampler;
+        std::unique_ptr<ChannelMapper> mapper;
+        std::atomic<float> gain;
+        std::atomic<float> pan;
+        float currentLeft;
+        float currentRight;
+    };
+
+    // The inputs the audio thread mixes. A list is never changed once published,
+    // adding or removing a source publishes a new copy and the old one is freed once the audio thread is done with it.
+    struct MixerInputList
+    {
+        std::vector<MixerInput*> inputs;
+    };
+
+    // Memory waiting for the audio thread to finish the pull it was in when the memory was unpublished.
+    struct RetiredInputs
+    {
+        std::unique_ptr<MixerInputList> list;
+        std::unique_ptr<MixerInput> input;
+        uint64_t pullCount;
+    };
+
     class Mixer: public InputStream
     {
     public:
+        Mixer();
+
+        // Preallocate scratch memory for pulls of up to maxFrames.
+        // Larger pulls still work, they are just mixed in several passes.
+        // Must not be called while the mixer is being pulled from.
+        void start(int maxFrames);
+
+        // Sources with a different sample rate than the mixer are resampled automatically.
+        // Sources can be added and removed while the mixer is being pulled from,
+        // but only from one control thread which is also the only thread that may call the setters below.
         bool add_source(Stream* stream);
+
+        // Once this returns the source is no longer pulled and can be destroyed.
+        // Waits for the pull in progress to finish if there is one, so this can block for up to one audio callback.
+        bool remove_source(Stream* stream);
+
         void pull(Buffer& buffer);
         StreamFormat get_format();
 
-        // Mixer will never be paused.
-        bool is_paused()
-        {
-            return false;
-        }
+        // Set the rate everything is mixed at, usually the output devices native rate.
+        // Without this the mixer runs at the rate of its first source.
+        // Must not be called while the mixer is being pulled from.
+        void set_format(StreamFormat format);
+
+        // Thread safe per source controls, changes are smoothed over the next pulled block.
+        // gain is linear, pan goes from -1.0 (left) to 1.0 (right).
+        bool set_gain(Stream* stream, float gain);
+        bool set_pan(Stream* stream, float pan);
+
+        // While paused nothing is pulled from the sources so they all stay in step with each other.
+        void set_pause(bool paused);
+        bool is_paused();
 
+        // Number of frames mixed since the mixer was created, pauses do not advance it.
+        int64_t get_frame_position();
+
+        // Deliver commands from queue on this mixers timeline, blocks are split so every command lands on its frame.
+        // Only the top mixer of a graph needs a queue, submixes are pulled in the same pieces.
+        // Commands can't wake a paused mixer since nothing is pulled, use set_pause for that.
+        // Must not be called while the mixer is being pulled from.
+        void set_command_queue(CommandQueue* queue);
+
+        // Handles gain commands for its inputs and pause/resume of itself.
+        void apply_command(const StreamCommand& command);
 
     private:
-        std::vector<Stream*> m_streams;
+        void mix_block(const MixerInputList* list, float* output, int frames, int channels);
+        void publish_inputs();
+        void retire(std::unique_ptr<MixerInputList> list, std::unique_ptr<MixerInput> input);
+        bool pull_finished(uint64_t pullCount);
+        void reclaim();
+        void connect_input(MixerInput* input);
+        void mix_input(MixerInput* input, float* output, const float* source, int frames, int channels, float gain);
+        MixerInput* find_input(Stream* stream);
+
+        // Owned by the control thread, m_activeList is what the audio thread reads.
+        std::vector<std::unique_ptr<MixerInput>> m_inputs;
+        std::unique_ptr<MixerInputList> m_inputList;
+        std::atomic<MixerInputList*> m_activeList;
+        std::vector<RetiredInputs> m_retired;
+
+        // Set while the audio thread is inside pull, m_pullCount goes up after every pull.
+        std::atomic_bool m_pulling;
+        std::atomic<uint64_t> m_pullCount;
+
+        AlignedFloats m_scratch;
+        int m_maxFrames;
+        StreamFormat m_format;
+        std::atomic_bool m_paused;
+        std::atomic<int64_t> m_framePosition;
+        CommandQueue* m_commands;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ORCore
+{
+    // Bounded lock-free multiple producer, single consumer queue.
+    // Any number of threads may push, exactly one thread may pop.
+    // Each slot carries a sequence number telling producers and the consumer whose turn it is,
+    // so pushing is a single compare and swap and nothing is ever allocated after construction.
+    template<typename T>
+    class MpscQueue
+    {
+    public:
+        // Capacity is rounded up to the next power of two.
+        MpscQueue(size_t capacity);
+
+        // Returns false if the queue is full.
+        bool push(const T& item);
+
+        // Returns false if the queue is empty.
+        bool pop(T& item);
+
+    private:
+        struct Slot
+        {
+            std::atomic<size_t> sequence;
+            T item;
+        };
+
+        std::vector<Slot> m_slots;
+        size_t m_mask;
+
+        // Keep the producer and consumer positions on different cache lines.
+        char m_pad0[64];
+        std::atomic<size_t> m_pushPos;
+        char m_pad1[64];
+        size_t m_popPos;
+        char m_pad2[64];
+    };
+
+    template<typename T>
+    MpscQueue<T>::MpscQueue(size_t capacity)
+    : m_pushPos(0), m_popPos(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+
+        m_slots = std::vector<Slot>(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_mask = size - 1;
+    }
+
+    template<typename T>
+    bool MpscQueue<T>::push(const T& item)
+    {
+        size_t pos = m_pushPos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot& slot = m_slots[pos & m_mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0)
+            {
+                // The slot is free for this position, claim it.
+                if (m_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.item = item;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The consumer has not freed this slot yet.
+                return false;
+            }
+            else
+            {
+                // Another producer got here first.
+                pos = m_pushPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template<typename T>
+    bool MpscQueue<T>::pop(T& item)
+    {
+        Slot& slot = m_slots[m_popPos & m_mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        // A claimed slot that is still being written also counts as empty.
+        if (sequence != m_popPos + 1)
+        {
+            return false;
+        }
+
+        item = slot.item;
+        slot.sequence.store(m_popPos + m_slots.size(), std::memory_order_release);
+        m_popPos++;
+        return true;
+    }
+}
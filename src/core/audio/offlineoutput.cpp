@@ -0,0 +1,214 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <chrono>
+#include <algorithm>
+
+#include "offlineoutput.hpp"
+
+namespace ORCore
+{
+    OfflineOutput::OfflineOutput(int blockFrames)
+    : m_logger(spdlog::get("default")),
+    m_blockFrames(blockFrames),
+    m_length(0),
+    m_format({0, 0}),
+    m_rendering(false),
+    m_position(0),
+    m_running(false),
+    m_framesRendered(0),
+    m_renderTime(0.0)
+    {
+    }
+
+    OfflineOutput::~OfflineOutput()
+    {
+        stop();
+    }
+
+    void OfflineOutput::set_source(Stream* stream)
+    {
+        m_source = stream;
+    }
+
+    void OfflineOutput::set_block_size(int frames)
+    {
+        m_blockFrames = frames;
+    }
+
+    void OfflineOutput::set_length(int64_t frames)
+    {
+        m_length = frames;
+    }
+
+    bool OfflineOutput::start()
+    {
+        if (m_source == nullptr)
+        {
+            m_logger->error("Audio output source stream null.");
+            return false;
+        }
+        stop();
+        m_running.store(true, std::memory_order_release);
+        m_thread = std::thread(&OfflineOutput::render_loop, this);
+        return true;
+    }
+
+    void OfflineOutput::stop()
+    {
+        m_running.store(false, std::memory_order_release);
+        wait();
+    }
+
+    void OfflineOutput::wait()
+    {
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    bool OfflineOutput::render()
+    {
+        m_running.store(true, std::memory_order_release);
+        return render_loop();
+    }
+
+    int64_t OfflineOutput::get_frames_rendered()
+    {
+        return m_framesRendered.load(std::memory_order_acquire);
+    }
+
+    double OfflineOutput::get_frames_per_second()
+    {
+        double renderTime = m_renderTime.load(std::memory_order_acquire);
+        if (renderTime <= 0.0)
+        {
+            return 0.0;
+        }
+        return get_frames_rendered() / renderTime;
+    }
+
+    bool OfflineOutput::render_step()
+    {
+        if (!m_rendering)
+        {
+            m_running.store(true, std::memory_order_release);
+            if (!begin_render())
+            {
+                return false;
+            }
+        }
+
+        if (m_running.load(std::memory_order_acquire) && render_block())
+        {
+            return true;
+        }
+        end_render();
+        return false;
+    }
+
+    bool OfflineOutput::render_loop()
+    {
+        if (!begin_render())
+        {
+            return false;
+        }
+
+        while (m_running.load(std::memory_order_acquire) && render_block())
+        {
+        }
+
+        end_render();
+        return true;
+    }
+
+    bool OfflineOutput::begin_render()
+    {
+        if (m_source == nullptr)
+        {
+            m_logger->error("Audio output source stream null.");
+            m_running.store(false, std::memory_order_release);
+            return false;
+        }
+
+        m_format = m_source->get_format();
+        if (!open(m_format))
+        {
+            m_running.store(false, std::memory_order_release);
+            return false;
+        }
+
+        m_blockData = make_aligned_floats(static_cast<size_t>(m_blockFrames) * m_format.channels);
+        m_position = 0;
+        m_framesRendered.store(0, std::memory_order_release);
+        m_startTime = std::chrono::steady_clock::now();
+        m_rendering = true;
+        return true;
+    }
+
+    bool OfflineOutput::render_block()
+    {
+        int frames = m_blockFrames;
+        if (m_length > 0)
+        {
+            frames = static_cast<int>(std::min<int64_t>(frames, m_length - m_position));
+            if (frames <= 0)
+            {
+                return false;
+            }
+        }
+        else if (m_source->is_paused())
+        {
+            return false;
+        }
+
+        Buffer buffer(m_blockData.get(), {m_format.channels, frames});
+        if (!m_source->is_paused())
+        {
+            m_source->pull(buffer);
+        }
+        else
+        {
+            buffer.clear();
+        }
+        write(buffer);
+
+        m_position += frames;
+        m_framesRendered.store(m_position, std::memory_order_release);
+        return true;
+    }
+
+    void OfflineOutput::end_render()
+    {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_startTime;
+        m_renderTime.store(elapsed.count(), std::memory_order_release);
+        m_running.store(false, std::memory_order_release);
+        m_rendering = false;
+
+        close();
+    }
+
+    NullOutput::NullOutput(int blockFrames)
+    : OfflineOutput(blockFrames)
+    {
+    }
+
+    NullOutput::~NullOutput()
+    {
+        stop();
+    }
+
+    bool NullOutput::open(StreamFormat format)
+    {
+        return true;
+    }
+
+    void NullOutput::write(Buffer& buffer)
+    {
+    }
+
+    void NullOutput::close()
+    {
+    }
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    // Base for consumers that are not tied to an audio device.
+    // The source is pulled in a tight loop as fast as the cpu allows.
+    // Rendering stops after the configured length, when a source reports it is paused or when stop() is called.
+    class OfflineOutput: public Consumer
+    {
+    public:
+        OfflineOutput(int blockFrames = 1024);
+
+        // Derived classes must call stop() in their destructor, open/write/close are called from the render thread.
+        virtual ~OfflineOutput();
+
+        void set_source(Stream* stream);
+        void set_block_size(int frames);
+
+        // Number of frames to render, 0 renders until the source pauses or stop() is called.
+        // Streams that are never paused such as mixers need a length.
+        void set_length(int64_t frames);
+
+        // Start rendering on a background thread.
+        bool start();
+        void stop();
+
+        // Wait for a background render started with start() to finish.
+        void wait();
+
+        // Render on the calling thread, returns once finished.
+        bool render();
+
+        // Render a single block on the calling thread so a DecodeTask can spread a render over many steps.
+        // Returns false once rendering has finished or failed to start.
+        // The render time used by get_frames_per_second() includes the time between steps.
+        bool render_step();
+
+        int64_t get_frames_rendered();
+        double get_frames_per_second();
+
+    protected:
+        std::shared_ptr<spdlog::logger> m_logger;
+
+        virtual bool open(StreamFormat format) = 0;
+        virtual void write(Buffer& buffer) = 0;
+        virtual void close() = 0;
+
+    private:
+        bool render_loop();
+        bool begin_render();
+        bool render_block();
+        void end_render();
+
+        Stream* m_source = nullptr;
+        int m_blockFrames;
+        int64_t m_length;
+
+        // State of the render in progress, only touched by the rendering thread.
+        StreamFormat m_format;
+        AlignedFloats m_blockData;
+        bool m_rendering;
+        int64_t m_position;
+        std::chrono::steady_clock::time_point m_startTime;
+
+        std::thread m_thread;
+        std::atomic_bool m_running;
+        std::atomic<int64_t> m_framesRendered;
+        std::atomic<double> m_renderTime;
+    };
+
+    // Discards all audio, useful for benchmarks and analysis passes.
+    class NullOutput: public OfflineOutput
+    {
+    public:
+        NullOutput(int blockFrames = 1024);
+        ~NullOutput();
+
+    protected:
+        bool open(StreamFormat format);
+        void write(Buffer& buffer);
+        void close();
+    };
+}
@@ -0,0 +1,118 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "opussource.hpp"
+#include "kernels.hpp"
+
+namespace ORCore
+{
+    const int opusSampleRate = 48000;
+
+    // Frames decoded at a time when the pulled buffer layout has to be mapped.
+    const int opusMapFrames = 960;
+
+    OpusSource::OpusSource(std::string filename)
+    : m_opusFile(nullptr),
+    m_format({opusSampleRate, 0}),
+    m_totalFrames(0),
+    m_timeSeek(-1.0)
+    {
+        int error = 0;
+        m_opusFile = op_open_file(filename.c_str(), &error);
+        if (m_opusFile == nullptr)
+        {
+            throw std::runtime_error("Opus: Failed to open " + filename);
+        }
+
+        // Chained files could change channel count between links, the first link decides for the whole file.
+        m_format.channels = op_channel_count(m_opusFile, -1);
+        m_totalFrames = static_cast<int64_t>(op_pcm_total(m_opusFile, -1));
+        m_mapBuffer = make_aligned_floats(static_cast<size_t>(opusMapFrames) * 2);
+
+        set_pause(false);
+        set_time(0.0);
+    }
+
+    OpusSource::~OpusSource()
+    {
+        op_free(m_opusFile);
+    }
+
+    StreamFormat OpusSource::get_format()
+    {
+        return m_format;
+    }
+
+    void OpusSource::pull(Buffer& buffer)
+    {
+        float* buf = buffer;
+        auto info = buffer.get_info();
+        int framesRead = 0;
+
+        // Apply any pending seek before reading so the data pulled is from the new position.
+        double seekTime = m_timeSeek.exchange(-1.0, std::memory_order_acq_rel);
+        if (seekTime >= 0.0)
+        {
+            op_pcm_seek(m_opusFile, static_cast<ogg_int64_t>(seekTime * opusSampleRate));
+        }
+
+        while (framesRead < info.frames)
+        {
+            float* dst = buf + (framesRead * info.channels);
+            int framesLeft = info.frames - framesRead;
+            int framesDecoded;
+
+            // opusfile can downmix to stereo itself, any other layout is mapped from that.
+            if (info.channels == m_format.channels)
+            {
+                framesDecoded = op_read_float(m_opusFile, dst, framesLeft * info.channels, nullptr);
+            }
+            else if (info.channels == 2)
+            {
+                framesDecoded = op_read_float_stereo(m_opusFile, dst, framesLeft * 2);
+            }
+            else
+            {
+                int frames = std::min(framesLeft, opusMapFrames);
+                framesDecoded = op_read_float_stereo(m_opusFile, m_mapBuffer.get(), frames * 2);
+                if (framesDecoded > 0)
+                {
+                    map_channels(dst, info.channels, m_mapBuffer.get(), 2, framesDecoded);
+                }
+            }
+
+            // OP_HOLE is a gap in the data which is skipped, any other error or the end of the file stops playback.
+            if (framesDecoded == OP_HOLE)
+            {
+                continue;
+            }
+            if (framesDecoded <= 0)
+            {
+                set_pause(true);
+                std::fill(dst, buf + buffer.size(), 0.0f);
+                break;
+            }
+            framesRead += framesDecoded;
+        }
+
+        set_time(op_pcm_tell(m_opusFile) / static_cast<double>(opusSampleRate));
+    }
+
+    void OpusSource::seek(double time)
+    {
+        m_timeSeek.store(time, std::memory_order_release);
+    }
+
+    double OpusSource::get_length()
+    {
+        return m_totalFrames / static_cast<double>(opusSampleRate);
+    }
+
+    int64_t OpusSource::get_frame_count()
+    {
+        return m_totalFrames;
+    }
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+#include <opus/opusfile.h>
+
+#include "decodersource.hpp"
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    // Opus always decodes at 48kHz and hands out interleaved samples, so no interleaving is needed here.
+    class OpusSource: public DecoderSource
+    {
+    public:
+        // Throws std::runtime_error if the file can't be opened.
+        OpusSource(std::string filename);
+        ~OpusSource();
+
+        StreamFormat get_format();
+        void pull(Buffer& buffer);
+        void seek(double time);
+        double get_length();
+        int64_t get_frame_count();
+
+    private:
+        OggOpusFile* m_opusFile;
+        StreamFormat m_format;
+        int64_t m_totalFrames;
+        std::atomic<double> m_timeSeek;
+
+        // Stereo decoded for buffers that are neither the file's layout nor stereo, before mapping.
+        AlignedFloats m_mapBuffer;
+    };
+}
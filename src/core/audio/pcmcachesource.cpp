@@ -0,0 +1,315 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include "config.hpp"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "pcmcachesource.hpp"
+#include "filesystem.hpp"
+#include "decoderregistry.hpp"
+#include "kernels.hpp"
+
+namespace ORCore
+{
+    // Cache files are a small header followed by interleaved native endian floats.
+    struct PcmCacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        int32_t sampleRate;
+        int32_t channels;
+        int64_t frames;
+        int64_t sourceSize;
+        int64_t sourceTime;
+    };
+
+    static const char pcmCacheMagic[4] = {'O', 'R', 'P', 'C'};
+    static const uint32_t pcmCacheVersion = 2;
+
+    // Frames decoded per step on the background thread.
+    static const int decodeChunkFrames = 16384;
+
+    static int64_t file_size(std::string filename)
+    {
+        std::ifstream file(filename, std::ios_base::ate | std::ios_base::binary);
+        if (!file)
+        {
+            return -1;
+        }
+        return static_cast<int64_t>(file.tellg());
+    }
+
+    PcmCacheSource::PcmCacheSource(std::string filename, size_t memoryBudget, std::string cachePath, DecoderPool* pool)
+    : m_filename(filename),
+    m_decoder(get_decoder_registry().open(filename)),
+    m_format(m_decoder->get_format()),
+    m_totalFrames(m_decoder->get_frame_count()),
+    m_cached(false),
+    m_samples(nullptr),
+    m_pool(pool),
+    m_cancel(false),
+    m_decodeDone(false),
+    m_decodedFrames(0),
+    m_seekFrame(-1),
+    m_position(0)
+    {
+        set_pause(false);
+        set_time(0.0);
+
+        // Nothing to decode and the memory is already mapped, play straight from the decoder.
+        m_samples = m_decoder->get_samples();
+        if (m_samples != nullptr)
+        {
+            m_cached = true;
+            m_decodeDone = true;
+            m_decodedFrames.store(m_totalFrames, std::memory_order_release);
+            return;
+        }
+
+        size_t bytes = static_cast<size_t>(m_totalFrames) * m_format.channels * sizeof(float);
+        if (m_totalFrames <= 0 || bytes > memoryBudget)
+        {
+            // Too big to keep in memory, just stream from the decoder.
+            return;
+        }
+        m_cached = true;
+
+        if (!cachePath.empty() && m_decoder->use_cache_file())
+        {
+            m_cacheFilename = fmt::format("{}{}{:016x}.pcm", cachePath, PATH_SEP, std::hash<std::string>()(filename));
+            if (load_cache_file())
+            {
+                return;
+            }
+        }
+
+        m_pcm = make_aligned_floats(static_cast<size_t>(m_totalFrames) * m_format.channels);
+        m_samples = m_pcm.get();
+        if (m_pool != nullptr)
+        {
+            m_pool->add(this);
+        }
+        else
+        {
+            m_thread = std::thread(&PcmCacheSource::decode_loop, this);
+        }
+    }
+
+    PcmCacheSource::~PcmCacheSource()
+    {
+        m_cancel.store(true, std::memory_order_release);
+        if (m_pool != nullptr)
+        {
+            m_pool->remove(this);
+        }
+        else if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    StreamFormat PcmCacheSource::get_format()
+    {
+        return m_format;
+    }
+
+    void PcmCacheSource::pull(Buffer& buffer)
+    {
+        if (!m_cached)
+        {
+            m_decoder->pull(buffer);
+            if (m_decoder->is_paused())
+            {
+                set_pause(true);
+            }
+            set_time(m_decoder->get_time());
+            return;
+        }
+
+        float* buf = buffer;
+        auto info = buffer.get_info();
+
+        int64_t seekFrame = m_seekFrame.exchange(-1, std::memory_order_acq_rel);
+        if (seekFrame >= 0)
+        {
+            m_position = std::min(seekFrame, m_totalFrames);
+        }
+
+        // Only frames the decoder thread has already finished can be played.
+        int64_t available = m_decodedFrames.load(std::memory_order_acquire) - m_position;
+        int64_t frames = std::max<int64_t>(0, std::min<int64_t>(info.frames, available));
+
+        const float* start = m_samples + (m_position * m_format.channels);
+        map_channels(buf, info.channels, start, m_format.channels, static_cast<int>(frames));
+        std::fill(buf + (frames * info.channels), buf + buffer.size(), 0.0f);
+
+        m_position += frames;
+        if (m_position >= m_totalFrames)
+        {
+            set_pause(true);
+        }
+        set_time(m_position / static_cast<double>(m_format.sampleRate));
+    }
+
+    void PcmCacheSource::seek(double time)
+    {
+        if (!m_cached)
+        {
+            m_decoder->seek(time);
+            m_decoder->set_pause(false);
+            return;
+        }
+        int64_t frame = static_cast<int64_t>(std::max(time, 0.0) * m_format.sampleRate);
+        m_seekFrame.store(frame, std::memory_order_release);
+    }
+
+    double PcmCacheSource::get_length()
+    {
+        return m_decoder->get_length();
+    }
+
+    bool PcmCacheSource::is_cached()
+    {
+        return m_cached;
+    }
+
+    bool PcmCacheSource::is_ready()
+    {
+        return !m_cached || m_decodedFrames.load(std::memory_order_acquire) >= m_totalFrames;
+    }
+
+    void PcmCacheSource::wait_decoded(double seconds)
+    {
+        if (!m_cached)
+        {
+            return;
+        }
+
+        int64_t frames = std::min(m_totalFrames, static_cast<int64_t>(seconds * m_format.sampleRate));
+        while (m_decodedFrames.load(std::memory_order_acquire) < frames)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    bool PcmCacheSource::decode_step()
+    {
+        if (m_decodeDone || m_cancel.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        int64_t decoded = m_decodedFrames.load(std::memory_order_relaxed);
+        int frames = static_cast<int>(std::min<int64_t>(decodeChunkFrames, m_totalFrames - decoded));
+
+        if (frames > 0 && !m_decoder->is_paused())
+        {
+            Buffer chunk(m_pcm.get() + (decoded * m_format.channels), {m_format.channels, frames});
+            m_decoder->pull(chunk);
+            m_decodedFrames.store(decoded + frames, std::memory_order_release);
+            return true;
+        }
+
+        // Some files report a slightly longer length than they decode to, those frames stay silent.
+        m_decodedFrames.store(m_totalFrames, std::memory_order_release);
+        m_decodeDone = true;
+
+        if (!m_cacheFilename.empty())
+        {
+            write_cache_file();
+        }
+        return true;
+    }
+
+    void PcmCacheSource::decode_loop()
+    {
+        while (decode_step())
+        {
+        }
+    }
+
+    bool PcmCacheSource::load_cache_file()
+    {
+        try
+        {
+            m_cacheFile.open(m_cacheFilename);
+        }
+        catch (std::runtime_error &err)
+        {
+            return false;
+        }
+
+        PcmCacheHeader header;
+        size_t expectedSize = sizeof(header) + (static_cast<size_t>(m_totalFrames) * m_format.channels * sizeof(float));
+        if (m_cacheFile.size() != expectedSize)
+        {
+            m_cacheFile.close();
+            return false;
+        }
+
+        std::memcpy(&header, m_cacheFile.data(), sizeof(header));
+        if (std::memcmp(header.magic, pcmCacheMagic, sizeof(pcmCacheMagic)) != 0 ||
+            header.version != pcmCacheVersion ||
+            header.sampleRate != m_format.sampleRate ||
+            header.channels != m_format.channels ||
+            header.frames != m_totalFrames ||
+            header.sourceSize != file_size(m_filename) ||
+            header.sourceTime != get_modified_time(m_filename))
+        {
+            m_cacheFile.close();
+            return false;
+        }
+
+        m_samples = reinterpret_cast<const float*>(m_cacheFile.data() + sizeof(header));
+        m_decodedFrames.store(m_totalFrames, std::memory_order_release);
+        return true;
+    }
+
+    void PcmCacheSource::write_cache_file()
+    {
+        auto logger = spdlog::get("default");
+
+        size_t pos = m_cacheFilename.rfind(PATH_SEP);
+        if (pos != std::string::npos)
+        {
+            create_path(m_cacheFilename.substr(0, pos));
+        }
+
+        PcmCacheHeader header;
+        std::memcpy(header.magic, pcmCacheMagic, sizeof(pcmCacheMagic));
+        header.version = pcmCacheVersion;
+        header.sampleRate = m_format.sampleRate;
+        header.channels = m_format.channels;
+        header.frames = m_totalFrames;
+        header.sourceSize = file_size(m_filename);
+        header.sourceTime = get_modified_time(m_filename);
+
+        // Write to a temp file first so a partially written cache is never loaded.
+        std::string tempFilename = m_cacheFilename + ".tmp";
+        std::ofstream file(tempFilename, std::ios_base::binary | std::ios_base::trunc);
+        if (!file)
+        {
+            if (logger)
+            {
+                logger->warn("Failed to write audio cache {}", m_cacheFilename);
+            }
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(m_pcm.get()),
+                   static_cast<std::streamsize>(m_totalFrames * m_format.channels * sizeof(float)));
+        file.close();
+
+        std::remove(m_cacheFilename.c_str());
+        std::rename(tempFilename.c_str(), m_cacheFilename.c_str());
+    }
+}
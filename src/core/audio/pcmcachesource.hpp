@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+#include "decodersource.hpp"
+#include "mappedfile.hpp"
+#include "decoderpool.hpp"
+
+namespace ORCore
+{
+    // Decodes a whole song into memory once on a background thread.
+    // Playback then only copies from a contiguous float buffer and seeking is just moving a frame index.
+    // If a cache path is given the decoded audio is also written there and memory mapped on the next load.
+    // The decoder is picked by the DecoderRegistry. Decoders that can hand out their samples directly,
+    // like memory mapped float wav files, are played in place without decoding or a cache file.
+    // Songs larger than the memory budget fall back to streaming decode through the decoder,
+    // in that case wrap this in a DecodeAhead so seeking does not happen on the audio thread.
+    // Decoding runs on its own thread unless a pool is given.
+    class PcmCacheSource: public ProducerStream, public DecodeTask
+    {
+    public:
+        PcmCacheSource(std::string filename, size_t memoryBudget = 256 * 1024 * 1024, std::string cachePath = "",
+                       DecoderPool* pool = nullptr);
+        ~PcmCacheSource();
+
+        // Decodes the next chunk of the song into memory.
+        bool decode_step();
+
+        StreamFormat get_format();
+        void pull(Buffer& buffer);
+        void seek(double time);
+        double get_length();
+
+        // True if the song is played from memory rather than streamed.
+        bool is_cached();
+
+        // True once the whole song has been decoded.
+        bool is_ready();
+
+        // Blocks until at least `seconds` of audio from the start are decoded so playback can't overtake the decoder.
+        void wait_decoded(double seconds);
+
+    private:
+        void decode_loop();
+        bool load_cache_file();
+        void write_cache_file();
+
+        std::string m_filename;
+        std::string m_cacheFilename;
+        std::unique_ptr<DecoderSource> m_decoder;
+        StreamFormat m_format;
+        int64_t m_totalFrames;
+        bool m_cached;
+
+        AlignedFloats m_pcm;
+        MappedFile m_cacheFile;
+        const float* m_samples;
+
+        DecoderPool* m_pool;
+        std::thread m_thread;
+        std::atomic_bool m_cancel;
+        bool m_decodeDone;
+        std::atomic<int64_t> m_decodedFrames;
+        std::atomic<int64_t> m_seekFrame;
+
+        // Only used by the audio thread.
+        int64_t m_position;
+    };
+}
@@ -0,0 +1,293 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "pitchdetector.hpp"
+#include "kernels.hpp"
+#include "rtlog.hpp"
+
+namespace ORCore
+{
+    // Mono audio the ring can hold before the analysis thread has to catch up.
+    const double pitchRingTime = 1.0;
+    const size_t pitchFrameCapacity = 256;
+    const int pitchMonoFrames = 1024;
+
+    PitchDetector::PitchDetector(double hopTime, float minFrequency, float maxFrequency, float threshold)
+    : m_stream(nullptr),
+    m_format({44100, 2}),
+    m_hopTime(hopTime),
+    m_minFrequency(minFrequency),
+    m_maxFrequency(maxFrequency),
+    m_threshold(threshold),
+    m_monoFrames(pitchMonoFrames),
+    m_droppedFrames(0),
+    m_hopFrames(0),
+    m_windowFrames(0),
+    m_minLag(0),
+    m_maxLag(0),
+    m_filled(0),
+    m_windowStart(0),
+    m_seenDropped(0),
+    m_hopCost(0.0),
+    m_maxHopCost(0.0),
+    m_running(false)
+    {
+    }
+
+    PitchDetector::~PitchDetector()
+    {
+        stop();
+    }
+
+    bool PitchDetector::add_source(Stream* stream)
+    {
+        stop();
+
+        m_stream = stream;
+        m_format = m_stream->get_format();
+
+        // YIN compares the window against itself shifted by every lag up to the longest period,
+        // so the window holds the longest period twice.
+        m_hopFrames = std::max(1, static_cast<int>(m_hopTime * m_format.sampleRate));
+        m_minLag = std::max(2, static_cast<int>(m_format.sampleRate / m_maxFrequency));
+        m_maxLag = std::max(m_minLag + 2, static_cast<int>(std::ceil(m_format.sampleRate / m_minFrequency)));
+        m_windowFrames = m_maxLag * 2;
+
+        // All memory used while pulling or analyzing is allocated here.
+        m_mono = make_aligned_floats(m_monoFrames);
+        m_window = make_aligned_floats(m_windowFrames);
+        m_difference.assign(m_maxLag + 1, 0.0);
+        m_pcm = std::make_unique<RingBuffer<float>>(static_cast<size_t>(pitchRingTime * m_format.sampleRate));
+        m_frames = std::make_unique<RingBuffer<PitchFrame>>(pitchFrameCapacity);
+
+        m_droppedFrames.store(0, std::memory_order_relaxed);
+        m_filled = 0;
+        m_windowStart = 0;
+        m_seenDropped = 0;
+        return true;
+    }
+
+    void PitchDetector::pull(Buffer& buffer)
+    {
+        m_stream->pull(buffer);
+
+        const float* buf = buffer;
+        auto info = buffer.get_info();
+        float scale = 1.0f / info.channels;
+        float* mono = m_mono.get();
+
+        for (int start = 0; start < info.frames; start += m_monoFrames)
+        {
+            int frames = std::min(m_monoFrames, info.frames - start);
+            const float* frame = buf + (start * info.channels);
+            for (int i = 0; i < frames; ++i)
+            {
+                float sum = 0.0f;
+                for (int c = 0; c < info.channels; ++c)
+                {
+                    sum += frame[c];
+                }
+                mono[i] = sum * scale;
+                frame += info.channels;
+            }
+
+            size_t written = m_pcm->write(mono, frames);
+            if (written < static_cast<size_t>(frames))
+            {
+                m_droppedFrames.fetch_add(frames - written, std::memory_order_release);
+                rt_log(RtLogLevel::warn, "Pitch detector overrun, dropped {} frames.", frames - written);
+            }
+        }
+    }
+
+    StreamFormat PitchDetector::get_format()
+    {
+        return m_stream->get_format();
+    }
+
+    bool PitchDetector::is_paused()
+    {
+        return m_stream == nullptr || m_stream->is_paused();
+    }
+
+    void PitchDetector::start()
+    {
+        if (m_running.exchange(true))
+        {
+            return;
+        }
+        m_thread = std::thread(&PitchDetector::analysis_loop, this);
+    }
+
+    void PitchDetector::stop()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    void PitchDetector::analysis_loop()
+    {
+        // Polling keeps the audio thread free of any wake up calls, half a hop keeps frames timely.
+        auto interval = std::chrono::duration<double>(m_hopTime / 2.0);
+        while (m_running.load(std::memory_order_acquire))
+        {
+            if (analyze() == 0)
+            {
+                std::this_thread::sleep_for(interval);
+            }
+        }
+    }
+
+    int PitchDetector::analyze()
+    {
+        int produced = 0;
+        while (true)
+        {
+            // Dropped audio leaves a gap in the ring, start over after it so times stay correct.
+            uint64_t dropped = m_droppedFrames.load(std::memory_order_acquire);
+            if (dropped != m_seenDropped)
+            {
+                m_seenDropped = dropped;
+                m_pcm->discard_to(m_pcm->get_write_position());
+                m_filled = 0;
+            }
+
+            size_t needed = static_cast<size_t>(m_windowFrames - m_filled);
+            if (m_pcm->read_available() < needed)
+            {
+                break;
+            }
+            if (m_filled == 0)
+            {
+                m_windowStart = m_pcm->get_read_position() + m_seenDropped;
+            }
+            m_pcm->read(m_window.get() + m_filled, needed);
+            m_filled = m_windowFrames;
+
+            auto start = std::chrono::steady_clock::now();
+            double time = (m_windowStart + (m_windowFrames / 2.0)) / m_format.sampleRate;
+            PitchFrame frame = detect(time);
+            std::chrono::duration<double> cost = std::chrono::steady_clock::now() - start;
+
+            m_hopCost.store(cost.count(), std::memory_order_relaxed);
+            if (cost.count() > m_maxHopCost.load(std::memory_order_relaxed))
+            {
+                m_maxHopCost.store(cost.count(), std::memory_order_relaxed);
+            }
+
+            // A reader that stopped reading loses the newest frames rather than blocking analysis.
+            m_frames->write(&frame, 1);
+            produced++;
+
+            // Slide the window forward by one hop.
+            float* window = m_window.get();
+            std::copy(window + m_hopFrames, window + m_windowFrames, window);
+            m_filled = m_windowFrames - m_hopFrames;
+            m_windowStart += m_hopFrames;
+        }
+        return produced;
+    }
+
+    PitchFrame PitchDetector::detect(double time)
+    {
+        const float* x = m_window.get();
+        int length = m_maxLag;
+        double* difference = m_difference.data();
+
+        // d(lag) = sum (x[j] - x[j + lag])^2 = energy(0) + energy(lag) - 2 * autocorrelation(lag),
+        // the energies are running sums so only the autocorrelation is a full pass per lag.
+        double energy0 = dot_product(x, x, length);
+        double energyLag = energy0;
+        double runningSum = 0.0;
+
+        PitchFrame frame = {time, 0.0f, 0.0f};
+        if (energy0 < 1e-8 * length)
+        {
+            return frame;
+        }
+
+        // Normalize by the running mean so the dip at lag 0 doesn't win, then take the first dip under
+        // the threshold rather than the deepest so octave errors are avoided.
+        difference[0] = 1.0;
+        for (int lag = 1; lag <= m_maxLag; ++lag)
+        {
+            energyLag += (static_cast<double>(x[lag + length - 1]) * x[lag + length - 1]) -
+                         (static_cast<double>(x[lag - 1]) * x[lag - 1]);
+            double d = energy0 + energyLag - (2.0 * dot_product(x, x + lag, length));
+            d = std::max(d, 0.0);
+            runningSum += d;
+            difference[lag] = runningSum > 0.0 ? (d * lag) / runningSum : 1.0;
+        }
+
+        int best = -1;
+        int deepest = m_minLag;
+        for (int lag = m_minLag; lag < m_maxLag; ++lag)
+        {
+            if (difference[lag] < difference[deepest])
+            {
+                deepest = lag;
+            }
+            if (difference[lag] < m_threshold)
+            {
+                while (lag + 1 < m_maxLag && difference[lag + 1] < difference[lag])
+                {
+                    lag++;
+                }
+                best = lag;
+                break;
+            }
+        }
+
+        if (best < 0)
+        {
+            frame.clarity = static_cast<float>(std::max(0.0, 1.0 - difference[deepest]));
+            return frame;
+        }
+
+        // Parabolic interpolation between neighbouring lags for sub sample accuracy.
+        double period = best;
+        double before = difference[best - 1];
+        double at = difference[best];
+        double after = difference[best + 1];
+        double curve = before + after - (2.0 * at);
+        if (curve > 0.0)
+        {
+            period += (0.5 * (before - after)) / curve;
+        }
+
+        frame.frequency = static_cast<float>(m_format.sampleRate / period);
+        frame.clarity = static_cast<float>(std::max(0.0, 1.0 - at));
+        return frame;
+    }
+
+    size_t PitchDetector::read_frames(PitchFrame* frames, size_t count)
+    {
+        return m_frames->read(frames, count);
+    }
+
+    int PitchDetector::get_hop_frames()
+    {
+        return m_hopFrames;
+    }
+
+    uint64_t PitchDetector::get_dropped_frames()
+    {
+        return m_droppedFrames.load(std::memory_order_relaxed);
+    }
+
+    double PitchDetector::get_hop_cost()
+    {
+        return m_hopCost.load(std::memory_order_relaxed);
+    }
+
+    double PitchDetector::get_max_hop_cost()
+    {
+        return m_maxHopCost.load(std::memory_order_relaxed);
+    }
+}
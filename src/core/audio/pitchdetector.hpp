@@ -0,0 +1,103 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cstdint>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+#include "ringbuffer.hpp"
+
+
+namespace ORCore
+{
+    struct PitchFrame
+    {
+        double time;     // Seconds of audio pulled through the detector, at the center of the analysis window.
+        float frequency; // Hz, 0 if the window is unvoiced.
+        float clarity;   // 0 to 1, how periodic the window is.
+    };
+
+    // Streaming YIN pitch detector for vocals.
+    // Pulling passes audio through untouched while a mono copy goes into a lock-free ring, an analysis thread
+    // reads the ring one hop at a time and queues a PitchFrame for every hop.
+    // Without start() nothing runs in the background and analyze() can be called directly,
+    // which is how files are analyzed offline by pulling a decoder through the detector.
+    class PitchDetector: public InputStream
+    {
+    public:
+        // hopTime is the time between pitch frames, the analysis window is long enough for minFrequency.
+        // threshold is the YIN threshold, lower values reject more breathy or noisy windows.
+        PitchDetector(double hopTime = 0.01, float minFrequency = 70.0f, float maxFrequency = 1100.0f,
+                      float threshold = 0.15f);
+        ~PitchDetector();
+
+        bool add_source(Stream* stream);
+        void pull(Buffer& buffer);
+        StreamFormat get_format();
+
+        bool is_paused();
+
+        // Run analyze() on a dedicated thread until stop() or destruction.
+        void start();
+        void stop();
+
+        // Analyze every full hop waiting in the ring, returns the number of pitch frames queued.
+        // Only one thread may analyze at a time.
+        int analyze();
+
+        // Takes up to count pitch frames in time order, returns how many were read.
+        // Only one thread may read frames.
+        size_t read_frames(PitchFrame* frames, size_t count);
+
+        // Hop sized chunk of audio frames, at the sources rate.
+        int get_hop_frames();
+
+        // Frames of audio dropped because the analysis fell more than the ring behind.
+        // Pitch frame times stay in step with the source across drops.
+        uint64_t get_dropped_frames();
+
+        // Analysis cost of the last hop and the worst hop so far, in seconds.
+        double get_hop_cost();
+        double get_max_hop_cost();
+
+    private:
+        void analysis_loop();
+        PitchFrame detect(double time);
+
+        Stream* m_stream;
+        StreamFormat m_format;
+        double m_hopTime;
+        float m_minFrequency;
+        float m_maxFrequency;
+        float m_threshold;
+
+        // Only used by the audio thread.
+        AlignedFloats m_mono;
+        int m_monoFrames;
+
+        std::unique_ptr<RingBuffer<float>> m_pcm;
+        std::unique_ptr<RingBuffer<PitchFrame>> m_frames;
+        std::atomic<uint64_t> m_droppedFrames;
+
+        // Only used by the analysis thread.
+        AlignedFloats m_window;
+        std::vector<double> m_difference;
+        int m_hopFrames;
+        int m_windowFrames;
+        int m_minLag;
+        int m_maxLag;
+        int m_filled;
+        uint64_t m_windowStart;
+        uint64_t m_seenDropped;
+
+        std::atomic<double> m_hopCost;
+        std::atomic<double> m_maxHopCost;
+        std::atomic_bool m_running;
+        std::thread m_thread;
+    };
+}
@@ -0,0 +1,174 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <cmath>
+#include "pitchshift.hpp"
+
+namespace ORCore
+{
+    PitchShift::PitchShift(int channels, float maxSemitones, double window)
+    : m_stream(nullptr),
+    m_format({44100, channels}),
+    m_channels(channels),
+    m_maxSemitones(maxSemitones),
+    m_window(window),
+    m_whammy(0.0f),
+    m_windowFrames(1),
+    m_delayMask(0),
+    m_writePos(0),
+    m_phase(0.5f),
+    m_ratio(1.0f),
+    m_wet(0.0f),
+    m_wetStep(1.0f)
+    {
+    }
+
+    void PitchShift::set_whammy(float amount)
+    {
+        m_whammy.store(std::min(std::max(amount, 0.0f), 1.0f), std::memory_order_relaxed);
+    }
+
+    bool PitchShift::add_source(Stream* stream)
+    {
+        StreamFormat format = stream->get_format();
+        if (format.channels <= 0)
+        {
+            return false;
+        }
+
+        m_stream = stream;
+        m_mapper.reset();
+        if (format.channels != m_channels)
+        {
+            m_mapper = std::make_unique<ChannelMapper>(m_channels);
+            m_mapper->add_source(stream);
+            m_stream = m_mapper.get();
+        }
+        m_format = {format.sampleRate, m_channels};
+
+        m_windowFrames = std::max(2, static_cast<int>(m_window * m_format.sampleRate));
+
+        // The taps read up to one frame past the window when interpolating.
+        int delayFrames = 1;
+        while (delayFrames < m_windowFrames + 2)
+        {
+            delayFrames *= 2;
+        }
+        m_delayMask = delayFrames - 1;
+
+        // All memory used while pulling is allocated here rather than on the audio thread.
+        size_t delaySize = static_cast<size_t>(delayFrames) * m_format.channels;
+        m_delayLine = make_aligned_floats(delaySize);
+        std::fill(m_delayLine.get(), m_delayLine.get() + delaySize, 0.0f);
+
+        // Bends fade in and out over one window.
+        m_wetStep = 1.0f / m_windowFrames;
+        m_writePos = 0;
+        m_phase = 0.5f;
+        m_ratio = 1.0f;
+        m_wet = 0.0f;
+        return true;
+    }
+
+    void PitchShift::pull(Buffer& buffer)
+    {
+        m_stream->pull(buffer);
+
+        float* buf = buffer;
+        auto info = buffer.get_info();
+        int channels = m_channels;
+        if (info.channels != channels)
+        {
+            return;
+        }
+        float* line = m_delayLine.get();
+
+        float amount = m_whammy.load(std::memory_order_relaxed);
+        float targetRatio = std::exp2(-(amount * m_maxSemitones) / 12.0f);
+        float targetWet = amount > 0.0f ? 1.0f : 0.0f;
+
+        // At rest only the delay line is kept filled so a bend can start from it.
+        if (m_wet == 0.0f && targetWet == 0.0f)
+        {
+            for (int i = 0; i < info.frames; ++i)
+            {
+                std::copy(buf + (i * channels), buf + ((i + 1) * channels), line + (m_writePos * channels));
+                m_writePos = (m_writePos + 1) & m_delayMask;
+            }
+            m_phase = 0.5f;
+            m_ratio = 1.0f;
+            return;
+        }
+
+        float ratioStep = (targetRatio - m_ratio) / std::max(1, info.frames);
+        float phaseScale = 1.0f / m_windowFrames;
+        float window = static_cast<float>(m_windowFrames);
+
+        for (int i = 0; i < info.frames; ++i)
+        {
+            float* frame = buf + (i * channels);
+            std::copy(frame, frame + channels, line + (m_writePos * channels));
+
+            // Reading slower than the source is written grows the tap delay, each tap wraps back to
+            // the front of the window where its gain has reached 0.
+            m_ratio += ratioStep;
+            m_phase += (1.0f - m_ratio) * phaseScale;
+            if (m_phase >= 1.0f)
+            {
+                m_phase -= 1.0f;
+            }
+            else if (m_phase < 0.0f)
+            {
+                m_phase += 1.0f;
+            }
+            float phaseB = m_phase >= 0.5f ? m_phase - 0.5f : m_phase + 0.5f;
+
+            // Triangle windows half a window apart always sum to 1.
+            float gainA = 1.0f - std::abs((2.0f * m_phase) - 1.0f);
+            float gainB = 1.0f - gainA;
+
+            float delayA = m_phase * window;
+            float delayB = phaseB * window;
+            int wholeA = static_cast<int>(delayA);
+            int wholeB = static_cast<int>(delayB);
+            float fracA = delayA - wholeA;
+            float fracB = delayB - wholeB;
+            const float* a0 = line + (((m_writePos - wholeA) & m_delayMask) * channels);
+            const float* a1 = line + (((m_writePos - wholeA - 1) & m_delayMask) * channels);
+            const float* b0 = line + (((m_writePos - wholeB) & m_delayMask) * channels);
+            const float* b1 = line + (((m_writePos - wholeB - 1) & m_delayMask) * channels);
+
+            if (m_wet != targetWet)
+            {
+                m_wet = targetWet > m_wet ? std::min(m_wet + m_wetStep, 1.0f) : std::max(m_wet - m_wetStep, 0.0f);
+            }
+
+            for (int c = 0; c < channels; ++c)
+            {
+                float tapA = a0[c] + (fracA * (a1[c] - a0[c]));
+                float tapB = b0[c] + (fracB * (b1[c] - b0[c]));
+                float shifted = (gainA * tapA) + (gainB * tapB);
+                frame[c] += m_wet * (shifted - frame[c]);
+            }
+
+            m_writePos = (m_writePos + 1) & m_delayMask;
+        }
+        m_ratio = targetRatio;
+    }
+
+    StreamFormat PitchShift::get_format()
+    {
+        return m_format;
+    }
+
+    int PitchShift::get_latency()
+    {
+        return m_windowFrames / 2;
+    }
+
+    bool PitchShift::is_paused()
+    {
+        return m_stream == nullptr || m_stream->is_paused();
+    }
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <atomic>
+#include <memory>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+#include "channelmapper.hpp"
+
+
+namespace ORCore
+{
+    // Real time pitch bend for a whammy bar.
+    // The source is read back from a short delay line by two taps that sweep through it at the bent rate,
+    // each fading out as it nears the end of the window while the other, half a window behind, takes over.
+    // The window bounds the added latency, the default of 10ms is short enough to play against.
+    // At rest the source passes through untouched with no latency, bends crossfade in and out of it.
+    // The delay line holds channels per frame, a source in another layout is mapped to it on the way in.
+    // Memory is allocated in add_source so pulling never allocates.
+    class PitchShift: public InputStream
+    {
+    public:
+        // channels is the layout pulled from this stage, normally the mixers.
+        // maxSemitones is how far down a fully pressed whammy bends.
+        PitchShift(int channels, float maxSemitones = 2.0f, double window = 0.01);
+
+        // amount is the controller axis from 0.0 at rest to 1.0 fully pressed.
+        // Safe to call from any thread, the bend glides to the new amount over the next pulled block.
+        void set_whammy(float amount);
+
+        bool add_source(Stream* stream);
+
+        // A buffer in a layout other than get_format gets the source without the bend.
+        void pull(Buffer& buffer);
+        StreamFormat get_format();
+
+        // Average delay in frames of the bent signal, the source is not delayed at rest.
+        int get_latency();
+
+        bool is_paused();
+
+    private:
+        Stream* m_stream;
+        std::unique_ptr<ChannelMapper> m_mapper;
+        StreamFormat m_format;
+        int m_channels;
+        float m_maxSemitones;
+        double m_window;
+
+        std::atomic<float> m_whammy;
+
+        // Only used by the audio thread.
+        AlignedFloats m_delayLine;
+        int m_windowFrames;
+        int m_delayMask;
+        int m_writePos;
+        float m_phase;
+        float m_ratio;
+        float m_wet;
+        float m_wetStep;
+    };
+}
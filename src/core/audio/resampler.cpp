@@ -0,0 +1,239 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   define RESAMPLER_SSE
+#   include <xmmintrin.h>
+#endif
+
+#include "resampler.hpp"
+#include "kernels.hpp"
+
+namespace ORCore
+{
+    const double pi = 3.14159265358979323846;
+
+    // Fraction of the nyquist frequency passed through, the rest is the filters transition band.
+    const double passBand = 0.95;
+
+    // Largest channel count a source can have.
+    const int maxResamplerChannels = 8;
+
+    // Linearly interpolate between two rows of filter coefficients.
+    static void lerp_coefficients(float* dst, const float* a, const float* b, float t, int taps)
+    {
+        int tap = 0;
+
+#if defined(RESAMPLER_SSE)
+        __m128 weight = _mm_set1_ps(t);
+        for (; tap < taps; tap += 4)
+        {
+            __m128 rowA = _mm_load_ps(a + tap);
+            __m128 rowB = _mm_load_ps(b + tap);
+            _mm_store_ps(dst + tap, _mm_add_ps(rowA, _mm_mul_ps(_mm_sub_ps(rowB, rowA), weight)));
+        }
+#endif
+
+        for (; tap < taps; ++tap)
+        {
+            dst[tap] = a[tap] + ((b[tap] - a[tap]) * t);
+        }
+    }
+
+    // Dot product of the filter with the source, the source is not guaranteed to be aligned.
+    static float convolve(const float* src, const float* coefficients, int taps)
+    {
+        int tap = 0;
+        float sum = 0.0f;
+
+#if defined(RESAMPLER_SSE)
+        __m128 accA = _mm_setzero_ps();
+        __m128 accB = _mm_setzero_ps();
+        for (; tap + 8 <= taps; tap += 8)
+        {
+            accA = _mm_add_ps(accA, _mm_mul_ps(_mm_loadu_ps(src + tap), _mm_load_ps(coefficients + tap)));
+            accB = _mm_add_ps(accB, _mm_mul_ps(_mm_loadu_ps(src + tap + 4), _mm_load_ps(coefficients + tap + 4)));
+        }
+        for (; tap + 4 <= taps; tap += 4)
+        {
+            accA = _mm_add_ps(accA, _mm_mul_ps(_mm_loadu_ps(src + tap), _mm_load_ps(coefficients + tap)));
+        }
+
+        __m128 acc = _mm_add_ps(accA, accB);
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        sum = _mm_cvtss_f32(acc);
+#endif
+
+        for (; tap < taps; ++tap)
+        {
+            sum += src[tap] * coefficients[tap];
+        }
+        return sum;
+    }
+
+    Resampler::Resampler(int outputRate, int taps, int phases, int blockFrames)
+    : m_stream(nullptr),
+    m_format({0, 0}),
+    m_outputRate(outputRate),
+    m_taps(std::max(4, taps - (taps % 4))),
+    m_phases(std::max(1, phases)),
+    m_blockFrames(blockFrames),
+    m_step(1.0),
+    m_historyCapacity(0),
+    m_historyFrames(0),
+    m_position(0.0)
+    {
+    }
+
+    bool Resampler::add_source(Stream* stream)
+    {
+        if (stream->get_format().channels > maxResamplerChannels)
+        {
+            return false;
+        }
+
+        m_stream = stream;
+        m_format = m_stream->get_format();
+        m_step = m_format.sampleRate / static_cast<double>(m_outputRate);
+
+        // All memory used while pulling is allocated here rather than on the audio thread.
+        m_historyCapacity = m_taps + m_blockFrames;
+        m_history = make_aligned_floats(static_cast<size_t>(m_historyCapacity) * m_format.channels);
+        m_inputBuffer = make_aligned_floats(static_cast<size_t>(m_blockFrames) * m_format.channels);
+        m_coefficients = make_aligned_floats(m_taps);
+        build_filter();
+
+        // Start with half a filter of silence so the first output frame lines up with the first source frame.
+        m_historyFrames = (m_taps / 2) - 1;
+        m_position = 0.0;
+
+        return true;
+    }
+
+    void Resampler::build_filter()
+    {
+        m_filter = make_aligned_floats(static_cast<size_t>(m_phases + 1) * m_taps);
+
+        double cutoff = passBand * std::min(1.0, 1.0 / m_step);
+        double halfWidth = m_taps / 2.0;
+
+        for (int phase = 0; phase <= m_phases; ++phase)
+        {
+            float* row = m_filter.get() + (phase * m_taps);
+            double fraction = phase / static_cast<double>(m_phases);
+            double sum = 0.0;
+
+            for (int tap = 0; tap < m_taps; ++tap)
+            {
+                // Distance from the filter center in source frames.
+                double x = tap - ((m_taps / 2) - 1) - fraction;
+                double sinc = x == 0.0 ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+
+                // Blackman window.
+                double w = x / halfWidth;
+                double window = 0.42 + (0.5 * std::cos(pi * w)) + (0.08 * std::cos(2.0 * pi * w));
+
+                row[tap] = static_cast<float>(sinc * window);
+                sum += row[tap];
+            }
+
+            // Normalize so every phase has unity gain at DC.
+            for (int tap = 0; tap < m_taps; ++tap)
+            {
+                row[tap] = static_cast<float>(row[tap] / sum);
+            }
+        }
+    }
+
+    // Move what is still needed to the front of the history then append a block from the source.
+    void Resampler::fill_input()
+    {
+        int consumed = std::min(static_cast<int>(m_position), m_historyFrames);
+        int remaining = m_historyFrames - consumed;
+
+        for (int c = 0; c < m_format.channels; ++c)
+        {
+            float* channel = m_history.get() + (c * m_historyCapacity);
+            std::memmove(channel, channel + consumed, remaining * sizeof(float));
+        }
+        m_historyFrames = remaining;
+        m_position -= consumed;
+
+        Buffer input(m_inputBuffer.get(), {m_format.channels, m_blockFrames});
+        if (m_stream->is_paused())
+        {
+            input.clear();
+        }
+        else
+        {
+            m_stream->pull(input);
+        }
+
+        float* channels[maxResamplerChannels];
+        for (int c = 0; c < m_format.channels; ++c)
+        {
+            channels[c] = m_history.get() + (c * m_historyCapacity) + m_historyFrames;
+        }
+        deinterleave(channels, m_inputBuffer.get(), m_blockFrames, m_format.channels);
+        m_historyFrames += m_blockFrames;
+    }
+
+    void Resampler::pull(Buffer& buffer)
+    {
+        float* buf = buffer;
+        auto info = buffer.get_info();
+        int channels = std::min(info.channels, m_format.channels);
+
+        if (channels < info.channels)
+        {
+            buffer.clear();
+        }
+
+        for (int frame = 0; frame < info.frames; ++frame)
+        {
+            while (static_cast<int>(m_position) + m_taps > m_historyFrames)
+            {
+                fill_input();
+            }
+
+            int index = static_cast<int>(m_position);
+            double phase = (m_position - index) * m_phases;
+            int row = static_cast<int>(phase);
+
+            lerp_coefficients(m_coefficients.get(),
+                              m_filter.get() + (row * m_taps),
+                              m_filter.get() + ((row + 1) * m_taps),
+                              static_cast<float>(phase - row), m_taps);
+
+            for (int c = 0; c < channels; ++c)
+            {
+                const float* channel = m_history.get() + (c * m_historyCapacity) + index;
+                buf[(frame * info.channels) + c] = convolve(channel, m_coefficients.get(), m_taps);
+            }
+
+            m_position += m_step;
+        }
+    }
+
+    StreamFormat Resampler::get_format()
+    {
+        return {m_outputRate, m_format.channels};
+    }
+
+    bool Resampler::is_paused()
+    {
+        return m_stream == nullptr || m_stream->is_paused();
+    }
+
+    double Resampler::get_latency()
+    {
+        // Source frames after the center of the filter have been pulled but not played yet.
+        double center = m_position + (m_taps / 2) - 1;
+        return (m_historyFrames - center) / m_step;
+    }
+}
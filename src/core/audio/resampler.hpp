@@ -0,0 +1,58 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include "streams.hpp"
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    // Converts a stream to another sample rate with a windowed sinc filter.
+    // The filter is precomputed for a fixed number of sub-sample phases and
+    // coefficients for positions in between two phases are linearly interpolated.
+    // When downsampling the cutoff is lowered to the output nyquist frequency to avoid aliasing.
+    class Resampler: public InputStream
+    {
+    public:
+        // taps must be a multiple of 4, more taps give a steeper filter at a higher cost.
+        // blockFrames is the size of each pull from the source stream.
+        Resampler(int outputRate, int taps = 32, int phases = 256, int blockFrames = 256);
+
+        bool add_source(Stream* stream);
+        void pull(Buffer& buffer);
+        StreamFormat get_format();
+
+        // Paused whenever the source is, the mixer skips it just like it would the source.
+        bool is_paused();
+
+        // Source audio that has been pulled but not played yet, in output frames.
+        double get_latency();
+
+    private:
+        void build_filter();
+        void fill_input();
+
+        Stream* m_stream;
+        StreamFormat m_format;
+        int m_outputRate;
+        int m_taps;
+        int m_phases;
+        int m_blockFrames;
+
+        // Source frames advanced per output frame.
+        double m_step;
+
+        // (phases + 1) rows of taps coefficients, the extra row makes interpolating the last phase simple.
+        AlignedFloats m_filter;
+        AlignedFloats m_coefficients;
+
+        // Source audio split into one contiguous run per channel so the filter reads straight through it.
+        AlignedFloats m_history;
+        AlignedFloats m_inputBuffer;
+        int m_historyCapacity;
+        int m_historyFrames;
+
+        // Index of the first filter tap within the history, the fraction selects the phase.
+        double m_position;
+    };
+}
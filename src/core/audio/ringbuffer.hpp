@@ -0,0 +1,144 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+namespace ORCore
+{
+    // Lock-free single producer, single consumer ring buffer.
+    // Exactly one thread may use the write side and exactly one other thread the read side.
+    // Read/write positions are free running counters, the difference between them is the fill level.
+    // This means positions can also be used as a timeline of everything that has passed through the buffer.
+    template<typename T>
+    class RingBuffer
+    {
+    public:
+        // Capacity is rounded up to the next power of two.
+        RingBuffer(size_t capacity);
+
+        // Producer side. Returns the number of items actually written.
+        size_t write(const T* data, size_t count);
+        size_t write_available();
+        size_t get_write_position();
+
+        // Consumer side. Returns the number of items actually read.
+        size_t read(T* data, size_t count);
+        size_t read_available();
+        size_t get_read_position();
+
+        // Consumer side. Drops everything before `position` which must not be past the write position.
+        void discard_to(size_t position);
+
+        size_t capacity();
+
+    private:
+        std::vector<T> m_data;
+        size_t m_mask;
+
+        // Keep the producer and consumer positions on different cache lines.
+        char m_pad0[64];
+        std::atomic<size_t> m_writePos;
+        char m_pad1[64];
+        std::atomic<size_t> m_readPos;
+        char m_pad2[64];
+    };
+
+    template<typename T>
+    RingBuffer<T>::RingBuffer(size_t capacity)
+    : m_writePos(0), m_readPos(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        m_data.resize(size);
+        m_mask = size - 1;
+    }
+
+    template<typename T>
+    size_t RingBuffer<T>::write(const T* data, size_t count)
+    {
+        size_t writePos = m_writePos.load(std::memory_order_relaxed);
+        size_t readPos = m_readPos.load(std::memory_order_acquire);
+
+        count = std::min(count, m_data.size() - (writePos - readPos));
+
+        size_t start = writePos & m_mask;
+        size_t firstPart = std::min(count, m_data.size() - start);
+
+        std::copy(data, data + firstPart, m_data.data() + start);
+        std::copy(data + firstPart, data + count, m_data.data());
+
+        m_writePos.store(writePos + count, std::memory_order_release);
+        return count;
+    }
+
+    template<typename T>
+    size_t RingBuffer<T>::write_available()
+    {
+        size_t writePos = m_writePos.load(std::memory_order_relaxed);
+        size_t readPos = m_readPos.load(std::memory_order_acquire);
+        return m_data.size() - (writePos - readPos);
+    }
+
+    template<typename T>
+    size_t RingBuffer<T>::get_write_position()
+    {
+        return m_writePos.load(std::memory_order_acquire);
+    }
+
+    template<typename T>
+    size_t RingBuffer<T>::read(T* data, size_t count)
+    {
+        size_t readPos = m_readPos.load(std::memory_order_relaxed);
+        size_t writePos = m_writePos.load(std::memory_order_acquire);
+
+        count = std::min(count, writePos - readPos);
+
+        size_t start = readPos & m_mask;
+        size_t firstPart = std::min(count, m_data.size() - start);
+
+        std::copy(m_data.data() + start, m_data.data() + start + firstPart, data);
+        std::copy(m_data.data(), m_data.data() + (count - firstPart), data + firstPart);
+
+        m_readPos.store(readPos + count, std::memory_order_release);
+        return count;
+    }
+
+    template<typename T>
+    size_t RingBuffer<T>::read_available()
+    {
+        size_t readPos = m_readPos.load(std::memory_order_relaxed);
+        size_t writePos = m_writePos.load(std::memory_order_acquire);
+        return writePos - readPos;
+    }
+
+    template<typename T>
+    size_t RingBuffer<T>::get_read_position()
+    {
+        return m_readPos.load(std::memory_order_acquire);
+    }
+
+    template<typename T>
+    void RingBuffer<T>::discard_to(size_t position)
+    {
+        size_t readPos = m_readPos.load(std::memory_order_relaxed);
+
+        // Compare using the signed difference so this keeps working if the counters wrap.
+        if (static_cast<std::ptrdiff_t>(position - readPos) > 0)
+        {
+            m_readPos.store(position, std::memory_order_release);
+        }
+    }
+
+    template<typename T>
+    size_t RingBuffer<T>::capacity()
+    {
+        return m_data.size();
+    }
+}
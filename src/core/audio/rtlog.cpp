@@ -0,0 +1,116 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <mutex>
+#include <chrono>
+
+#include "rtlog.hpp"
+#include "mpscqueue.hpp"
+
+namespace ORCore
+{
+    const size_t rtLogCapacity = 1024;
+
+    // Constructed during static initialization so the audio thread never triggers the allocation.
+    static MpscQueue<RtLogRecord> rtLogQueue(rtLogCapacity);
+    static std::atomic<uint64_t> rtLogDropped(0);
+
+    // Only one thread may pop from the ring.
+    static std::mutex rtLogDrainMutex;
+
+    void rt_log_record(const RtLogRecord& record)
+    {
+        if (!rtLogQueue.push(record))
+        {
+            rtLogDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t get_rt_log_dropped()
+    {
+        return rtLogDropped.load(std::memory_order_relaxed);
+    }
+
+    static std::string format_record(const RtLogRecord& record)
+    {
+        std::string message;
+        int arg = 0;
+        for (const char* c = record.format; *c != '\0'; ++c)
+        {
+            if (c[0] == '{' && c[1] == '}' && arg < record.argCount)
+            {
+                const RtLogArg& value = record.args[arg++];
+                message += value.isReal ? fmt::format("{:.3f}", value.real) : fmt::format("{}", value.integer);
+                ++c;
+            }
+            else
+            {
+                message += *c;
+            }
+        }
+        return message;
+    }
+
+    RtLogDrain::RtLogDrain(std::string loggerName, int intervalMs)
+    : m_logger(spdlog::get(loggerName)),
+    m_intervalMs(intervalMs),
+    m_running(true),
+    m_reportedDrops(0)
+    {
+        m_thread = std::thread(&RtLogDrain::drain_loop, this);
+    }
+
+    RtLogDrain::~RtLogDrain()
+    {
+        m_running.store(false, std::memory_order_release);
+        m_thread.join();
+        drain();
+    }
+
+    void RtLogDrain::drain()
+    {
+        std::lock_guard<std::mutex> lock(rtLogDrainMutex);
+
+        RtLogRecord record;
+        while (rtLogQueue.pop(record))
+        {
+            if (m_logger == nullptr)
+            {
+                continue;
+            }
+
+            std::string message = format_record(record);
+            switch (record.level)
+            {
+                case RtLogLevel::debug:
+                    m_logger->debug(message);
+                    break;
+                case RtLogLevel::info:
+                    m_logger->info(message);
+                    break;
+                case RtLogLevel::warn:
+                    m_logger->warn(message);
+                    break;
+                case RtLogLevel::error:
+                    m_logger->error(message);
+                    break;
+            }
+        }
+
+        uint64_t dropped = get_rt_log_dropped();
+        if (m_logger != nullptr && dropped > m_reportedDrops)
+        {
+            m_logger->warn("Audio log ring overflowed, {} messages dropped.", dropped - m_reportedDrops);
+            m_reportedDrops = dropped;
+        }
+    }
+
+    void RtLogDrain::drain_loop()
+    {
+        while (m_running.load(std::memory_order_acquire))
+        {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(m_intervalMs));
+        }
+    }
+}
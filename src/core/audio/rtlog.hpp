@@ -0,0 +1,92 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <type_traits>
+
+#include <spdlog/spdlog.h>
+
+namespace ORCore
+{
+    // Logging for the audio thread and stream stages.
+    // spdlog can lock and allocate, so the hot path only copies a small fixed size record into a lock-free ring,
+    // formatting and writing to the real logger happens later on the RtLogDrain thread.
+
+    const int maxRtLogArgs = 4;
+
+    enum class RtLogLevel
+    {
+        debug,
+        info,
+        warn,
+        error,
+    };
+
+    struct RtLogArg
+    {
+        bool isReal;
+        int64_t integer;
+        double real;
+    };
+
+    // format must be a string literal, only the pointer is stored. Each {} is replaced by the next argument.
+    struct RtLogRecord
+    {
+        RtLogLevel level;
+        const char* format;
+        int argCount;
+        RtLogArg args[maxRtLogArgs];
+    };
+
+    // Never blocks or allocates, the record is dropped if the ring is full.
+    void rt_log_record(const RtLogRecord& record);
+
+    // Records dropped because the ring was full.
+    uint64_t get_rt_log_dropped();
+
+    template<typename T>
+    RtLogArg make_rt_log_arg(T value)
+    {
+        static_assert(std::is_arithmetic<T>::value, "Only numbers can be logged from the audio thread.");
+        if (std::is_floating_point<T>::value)
+        {
+            return {true, 0, static_cast<double>(value)};
+        }
+        return {false, static_cast<int64_t>(value), 0.0};
+    }
+
+    // Usable from any thread including the audio thread, arguments can only be numbers.
+    template<typename... Args>
+    void rt_log(RtLogLevel level, const char* format, Args... args)
+    {
+        static_assert(sizeof...(Args) <= maxRtLogArgs, "Too many arguments for rt_log.");
+        RtLogRecord record{level, format, static_cast<int>(sizeof...(Args)), {make_rt_log_arg(args)...}};
+        rt_log_record(record);
+    }
+
+    // Owns the thread that moves records from the ring into a spdlog logger.
+    // Create one once the logger is registered, anything left is written out when it is destroyed.
+    class RtLogDrain
+    {
+    public:
+        RtLogDrain(std::string loggerName = "default", int intervalMs = 50);
+        ~RtLogDrain();
+
+        // Write out everything currently in the ring, called by the thread but also safe to call directly.
+        void drain();
+
+    private:
+        void drain_loop();
+
+        std::shared_ptr<spdlog::logger> m_logger;
+        int m_intervalMs;
+        std::atomic_bool m_running;
+        uint64_t m_reportedDrops;
+        std::thread m_thread;
+    };
+}
@@ -0,0 +1,383 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   define SAMPLER_SSE
+#   include <xmmintrin.h>
+#endif
+
+#include "samplersource.hpp"
+#include "decoderregistry.hpp"
+#include "resampler.hpp"
+
+namespace ORCore
+{
+    // Frames decoded or resampled per pull while loading a sample.
+    const int loadBlockFrames = 4096;
+
+    // Plays back interleaved audio that is already in memory, then silence.
+    // Only used to feed the resampler while loading.
+    class MemoryStream: public Stream
+    {
+    public:
+        MemoryStream(const float* samples, int64_t frames, StreamFormat format)
+        : m_samples(samples), m_frames(frames), m_format(format), m_position(0)
+        {
+        }
+
+        void pull(Buffer& buffer)
+        {
+            float* buf = buffer;
+            auto info = buffer.get_info();
+            int64_t count = std::max<int64_t>(0, std::min<int64_t>(info.frames, m_frames - m_position));
+
+            std::copy(m_samples + (m_position * m_format.channels),
+                      m_samples + ((m_position + count) * m_format.channels), buf);
+            std::fill(buf + (count * m_format.channels), buf + buffer.size(), 0.0f);
+            m_position += count;
+        }
+
+        StreamFormat get_format()
+        {
+            return m_format;
+        }
+
+        bool is_paused()
+        {
+            return false;
+        }
+
+    private:
+        const float* m_samples;
+        int64_t m_frames;
+        StreamFormat m_format;
+        int64_t m_position;
+    };
+
+    // Same balance pan law the mixer uses.
+    static void pan_gains(float gain, float pan, float& left, float& right)
+    {
+        pan = std::max(-1.0f, std::min(1.0f, pan));
+        left = gain * std::min(1.0f, 1.0f - pan);
+        right = gain * std::min(1.0f, 1.0f + pan);
+    }
+
+    // Add a mono sample to a stereo output.
+    static void mix_mono_stereo(float* dst, const float* src, int frames, float left, float right)
+    {
+        int frame = 0;
+
+#if defined(SAMPLER_SSE)
+        __m128 gain = _mm_setr_ps(left, right, left, right);
+        for (; frame + 4 <= frames; frame += 4)
+        {
+            __m128 mono = _mm_loadu_ps(src + frame);
+            __m128 low = _mm_mul_ps(_mm_unpacklo_ps(mono, mono), gain);
+            __m128 high = _mm_mul_ps(_mm_unpackhi_ps(mono, mono), gain);
+            _mm_storeu_ps(dst + (frame * 2), _mm_add_ps(_mm_loadu_ps(dst + (frame * 2)), low));
+            _mm_storeu_ps(dst + (frame * 2) + 4, _mm_add_ps(_mm_loadu_ps(dst + (frame * 2) + 4), high));
+        }
+#endif
+
+        for (; frame < frames; ++frame)
+        {
+            dst[frame * 2] += src[frame] * left;
+            dst[(frame * 2) + 1] += src[frame] * right;
+        }
+    }
+
+    // Add a stereo sample to a stereo output.
+    static void mix_stereo_stereo(float* dst, const float* src, int frames, float left, float right)
+    {
+        int sample = 0;
+        int samples = frames * 2;
+
+#if defined(SAMPLER_SSE)
+        __m128 gain = _mm_setr_ps(left, right, left, right);
+        for (; sample + 8 <= samples; sample += 8)
+        {
+            __m128 a = _mm_mul_ps(_mm_loadu_ps(src + sample), gain);
+            __m128 b = _mm_mul_ps(_mm_loadu_ps(src + sample + 4), gain);
+            _mm_storeu_ps(dst + sample, _mm_add_ps(_mm_loadu_ps(dst + sample), a));
+            _mm_storeu_ps(dst + sample + 4, _mm_add_ps(_mm_loadu_ps(dst + sample + 4), b));
+        }
+#endif
+
+        for (; sample < samples; sample += 2)
+        {
+            dst[sample] += src[sample] * left;
+            dst[sample + 1] += src[sample + 1] * right;
+        }
+    }
+
+    // Any other layout, the sample goes to the first two output channels or is summed for mono output.
+    static void mix_generic(float* dst, int dstChannels, const float* src, int srcChannels, int frames,
+                            float left, float right)
+    {
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            const float* in = src + (frame * srcChannels);
+            float* out = dst + (frame * dstChannels);
+            float inLeft = in[0];
+            float inRight = in[srcChannels - 1];
+
+            if (dstChannels == 1)
+            {
+                out[0] += ((inLeft * left) + (inRight * right)) * 0.5f;
+            }
+            else
+            {
+                out[0] += inLeft * left;
+                out[1] += inRight * right;
+            }
+        }
+    }
+
+    SamplerSource::SamplerSource(StreamFormat format, int maxVoices, int maxSamples, int queueSize)
+    : m_format(format),
+    m_samples(std::make_unique<SampleData[]>(maxSamples)),
+    m_maxSamples(maxSamples),
+    m_sampleCount(0),
+    m_triggers(queueSize),
+    m_voices(std::make_unique<SamplerVoice[]>(maxVoices)),
+    m_maxVoices(maxVoices),
+    m_voiceOrder(0),
+    m_pending(std::make_unique<SampleTrigger[]>(queueSize)),
+    m_maxPending(queueSize),
+    m_pendingCount(0),
+    m_framePosition(0),
+    m_activeVoices(0)
+    {
+        if (m_format.channels < 1 || m_format.channels > 2)
+        {
+            throw std::runtime_error("SamplerSource: only mono and stereo output is supported.");
+        }
+
+        for (int i = 0; i < m_maxVoices; ++i)
+        {
+            m_voices[i].active = false;
+        }
+        set_pause(false);
+        set_time(0.0);
+    }
+
+    int SamplerSource::load_sample(std::string filename)
+    {
+        std::unique_ptr<DecoderSource> decoder;
+        StreamFormat format;
+        int64_t frames;
+        AlignedFloats samples;
+
+        // Missing files, formats no decoder reads and decode errors all count as unsupported.
+        try
+        {
+            decoder = get_decoder_registry().open(filename);
+            format = decoder->get_format();
+            frames = decoder->get_frame_count();
+            if (frames <= 0 || format.channels < 1 || format.channels > 2)
+            {
+                return -1;
+            }
+
+            samples = make_aligned_floats(static_cast<size_t>(frames) * format.channels);
+            int64_t decoded = 0;
+            while (decoded < frames && !decoder->is_paused())
+            {
+                int count = static_cast<int>(std::min<int64_t>(loadBlockFrames, frames - decoded));
+                Buffer block(samples.get() + (decoded * format.channels), {format.channels, count});
+                decoder->pull(block);
+                decoded += count;
+            }
+
+            // A file shorter than it claimed to be ends in silence.
+            std::fill(samples.get() + (decoded * format.channels),
+                      samples.get() + (frames * format.channels), 0.0f);
+        }
+        catch (std::runtime_error &err)
+        {
+            return -1;
+        }
+
+        return add_sample(samples.get(), frames, format);
+    }
+
+    int SamplerSource::add_sample(const float* samples, int64_t frames, StreamFormat format)
+    {
+        int index = m_sampleCount.load(std::memory_order_relaxed);
+        if (index >= m_maxSamples || format.channels < 1 || format.channels > 2 || frames <= 0)
+        {
+            return -1;
+        }
+
+        SampleData& data = m_samples[index];
+        data.channels = format.channels;
+
+        if (format.sampleRate == m_format.sampleRate)
+        {
+            data.frames = frames;
+            data.samples = make_aligned_floats(static_cast<size_t>(frames) * format.channels);
+            std::copy(samples, samples + (frames * format.channels), data.samples.get());
+        }
+        else
+        {
+            // Converting here means playback never has to interpolate.
+            double ratio = m_format.sampleRate / static_cast<double>(format.sampleRate);
+            data.frames = static_cast<int64_t>(std::ceil(frames * ratio));
+            data.samples = make_aligned_floats(static_cast<size_t>(data.frames) * format.channels);
+
+            MemoryStream source(samples, frames, format);
+            Resampler resampler(m_format.sampleRate);
+            resampler.add_source(&source);
+
+            int64_t converted = 0;
+            while (converted < data.frames)
+            {
+                int count = static_cast<int>(std::min<int64_t>(loadBlockFrames, data.frames - converted));
+                Buffer block(data.samples.get() + (converted * format.channels), {format.channels, count});
+                resampler.pull(block);
+                converted += count;
+            }
+        }
+
+        // Publish the sample only once it is completely written.
+        m_sampleCount.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    bool SamplerSource::trigger(int sample, int64_t frame, float gain, float pan)
+    {
+        if (sample < 0 || sample >= m_sampleCount.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        return m_triggers.push({sample, gain, pan, frame});
+    }
+
+    int64_t SamplerSource::get_frame_position()
+    {
+        return m_framePosition.load(std::memory_order_acquire);
+    }
+
+    int SamplerSource::get_active_voices()
+    {
+        return m_activeVoices.load(std::memory_order_relaxed);
+    }
+
+    StreamFormat SamplerSource::get_format()
+    {
+        return m_format;
+    }
+
+    void SamplerSource::start_voice(const SampleTrigger& trigger, int offset)
+    {
+        SamplerVoice* voice = nullptr;
+        SamplerVoice* oldest = &m_voices[0];
+
+        for (int i = 0; i < m_maxVoices; ++i)
+        {
+            if (!m_voices[i].active)
+            {
+                voice = &m_voices[i];
+                break;
+            }
+            if (m_voices[i].order < oldest->order)
+            {
+                oldest = &m_voices[i];
+            }
+        }
+
+        // Every voice is busy, steal the one that has been playing the longest.
+        if (voice == nullptr)
+        {
+            voice = oldest;
+        }
+
+        voice->sample = trigger.sample;
+        voice->position = 0;
+        voice->offset = offset;
+        voice->order = m_voiceOrder++;
+        voice->active = true;
+        pan_gains(trigger.gain, trigger.pan, voice->left, voice->right);
+    }
+
+    bool SamplerSource::render_voice(SamplerVoice& voice, float* output, int frames, int channels)
+    {
+        const SampleData& data = m_samples[voice.sample];
+        int count = static_cast<int>(std::min<int64_t>(frames - voice.offset, data.frames - voice.position));
+        const float* src = data.samples.get() + (voice.position * data.channels);
+        float* dst = output + (voice.offset * channels);
+
+        if (channels == 2 && data.channels == 1)
+        {
+            mix_mono_stereo(dst, src, count, voice.left, voice.right);
+        }
+        else if (channels == 2 && data.channels == 2)
+        {
+            mix_stereo_stereo(dst, src, count, voice.left, voice.right);
+        }
+        else
+        {
+            mix_generic(dst, channels, src, data.channels, count, voice.left, voice.right);
+        }
+
+        voice.position += count;
+        voice.offset = 0;
+        voice.active = voice.position < data.frames;
+        return voice.active;
+    }
+
+    void SamplerSource::pull(Buffer& buffer)
+    {
+        float* buf = buffer;
+        auto info = buffer.get_info();
+        buffer.clear();
+
+        int64_t blockStart = m_framePosition.load(std::memory_order_relaxed);
+        int64_t blockEnd = blockStart + info.frames;
+
+        // Earlier triggers start first so they are also the first to be stolen.
+        for (int i = 0; i < m_pendingCount;)
+        {
+            if (m_pending[i].frame < blockEnd)
+            {
+                start_voice(m_pending[i], static_cast<int>(std::max<int64_t>(0, m_pending[i].frame - blockStart)));
+                m_pending[i] = m_pending[--m_pendingCount];
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        SampleTrigger trigger;
+        while (m_triggers.pop(trigger))
+        {
+            if (trigger.frame < blockEnd)
+            {
+                // Triggers that arrive late play right away rather than being cut short.
+                start_voice(trigger, static_cast<int>(std::max<int64_t>(0, trigger.frame - blockStart)));
+            }
+            else if (m_pendingCount < m_maxPending)
+            {
+                m_pending[m_pendingCount++] = trigger;
+            }
+        }
+
+        int active = 0;
+        for (int i = 0; i < m_maxVoices; ++i)
+        {
+            if (m_voices[i].active && render_voice(m_voices[i], buf, info.frames, info.channels))
+            {
+                active++;
+            }
+        }
+
+        m_activeVoices.store(active, std::memory_order_relaxed);
+        m_framePosition.store(blockEnd, std::memory_order_release);
+        set_time(blockEnd / static_cast<double>(m_format.sampleRate));
+    }
+}
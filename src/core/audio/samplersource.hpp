@@ -0,0 +1,105 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+#include "mpscqueue.hpp"
+
+namespace ORCore
+{
+    // A request to start a sample, frame is on the timeline returned by SamplerSource::get_frame_position.
+    struct SampleTrigger
+    {
+        int sample;
+        float gain;
+        float pan;
+        int64_t frame;
+    };
+
+    // A decoded one-shot sound, already converted to the samplers sample rate.
+    struct SampleData
+    {
+        AlignedFloats samples;
+        int64_t frames;
+        int channels;
+    };
+
+    // Only used by the audio thread.
+    struct SamplerVoice
+    {
+        int sample;
+        int64_t position;
+        float left;
+        float right;
+
+        // Frame within the current block the voice starts at, only non zero on its first block.
+        int offset;
+
+        // Increasing start counter, the voice with the lowest value is stolen first.
+        uint64_t order;
+        bool active;
+    };
+
+    // Plays short one-shot sounds such as hit, miss and crowd effects.
+    // Samples are decoded into memory up front and played from a fixed pool of voices,
+    // when every voice is busy the oldest one is stolen.
+    // Triggers are passed from any thread to the audio thread through a lock-free queue,
+    // so neither side allocates or locks when a sound is fired.
+    class SamplerSource: public ProducerStream
+    {
+    public:
+        SamplerSource(StreamFormat format = {44100, 2}, int maxVoices = 256, int maxSamples = 128, int queueSize = 1024);
+
+        // Decodes a whole file into the sample bank, samples are resampled to the samplers rate if needed.
+        // These allocate so they should be called while loading, never from the audio thread.
+        // Returns the sample id, or -1 if the bank is full or the format is unsupported.
+        int load_sample(std::string filename);
+        int add_sample(const float* samples, int64_t frames, StreamFormat format);
+
+        // Start a sample at the given frame, frames that have already been mixed play as soon as possible.
+        // gain is linear, pan goes from -1.0 (left) to 1.0 (right).
+        // Safe to call from any thread, returns false if the sample is unknown or the queue is full.
+        bool trigger(int sample, int64_t frame = 0, float gain = 1.0f, float pan = 0.0f);
+
+        // Number of frames rendered since the sampler was created.
+        int64_t get_frame_position();
+
+        // Voices that were playing at the end of the last pull.
+        int get_active_voices();
+
+        StreamFormat get_format();
+        void pull(Buffer& buffer);
+
+    private:
+        void start_voice(const SampleTrigger& trigger, int offset);
+        bool render_voice(SamplerVoice& voice, float* output, int frames, int channels);
+
+        StreamFormat m_format;
+
+        // Fixed size bank, slots below m_sampleCount are fully loaded and never change again.
+        std::unique_ptr<SampleData[]> m_samples;
+        int m_maxSamples;
+        std::atomic<int> m_sampleCount;
+
+        MpscQueue<SampleTrigger> m_triggers;
+
+        // Only used by the audio thread.
+        std::unique_ptr<SamplerVoice[]> m_voices;
+        int m_maxVoices;
+        uint64_t m_voiceOrder;
+
+        // Triggers taken from the queue that start in a later block.
+        std::unique_ptr<SampleTrigger[]> m_pending;
+        int m_maxPending;
+        int m_pendingCount;
+
+        std::atomic<int64_t> m_framePosition;
+        std::atomic<int> m_activeVoices;
+    };
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "segmentsource.hpp"
+#include "decoderregistry.hpp"
+#include "kernels.hpp"
+
+namespace ORCore
+{
+    // Small so the first step, which playback waits on, finishes quickly.
+    static const int segmentChunkFrames = 4096;
+
+    SegmentSource::SegmentSource(std::vector<std::string> filenames, double start, double length, double fadeTime)
+    : m_format({0, 0}),
+    m_segmentFrames(0),
+    m_totalFrames(0),
+    m_fadeFrames(0),
+    m_decodedFrames(0),
+    m_fadeOut(false),
+    m_position(0),
+    m_fadeOutStart(-1)
+    {
+        for (auto &filename : filenames)
+        {
+            auto decoder = get_decoder_registry().open(filename);
+            StreamFormat format = decoder->get_format();
+            if (m_decoders.empty())
+            {
+                m_format = format;
+            }
+            else if (format.sampleRate != m_format.sampleRate || format.channels != m_format.channels)
+            {
+                continue;
+            }
+            m_decoders.push_back(std::move(decoder));
+        }
+
+        if (m_decoders.empty())
+        {
+            throw std::runtime_error("Segment: No files to play.");
+        }
+
+        m_segmentFrames = static_cast<int64_t>(length * m_format.sampleRate);
+        m_fadeFrames = std::max<int64_t>(1, static_cast<int64_t>(fadeTime * m_format.sampleRate));
+        m_pcm = make_aligned_floats(static_cast<size_t>(m_segmentFrames) * m_format.channels);
+        m_scratch = make_aligned_floats(static_cast<size_t>(segmentChunkFrames) * m_format.channels);
+
+        set_start(start);
+        set_pause(false);
+        set_time(0.0);
+    }
+
+    double SegmentSource::get_file_length()
+    {
+        return m_decoders.front()->get_length();
+    }
+
+    void SegmentSource::set_start(double start)
+    {
+        start = std::max(0.0, std::min(start, get_file_length()));
+        for (auto &decoder : m_decoders)
+        {
+            decoder->seek(start);
+        }
+
+        // Segments near the end of the file are cut short.
+        int64_t remaining = static_cast<int64_t>((get_file_length() - start) * m_format.sampleRate);
+        m_totalFrames = std::max<int64_t>(0, std::min(m_segmentFrames, remaining));
+    }
+
+    bool SegmentSource::decode_step()
+    {
+        int64_t decoded = m_decodedFrames.load(std::memory_order_relaxed);
+        int frames = static_cast<int>(std::min<int64_t>(segmentChunkFrames, m_totalFrames - decoded));
+        if (frames <= 0)
+        {
+            return false;
+        }
+
+        float* chunk = m_pcm.get() + (decoded * m_format.channels);
+        size_t samples = static_cast<size_t>(frames) * m_format.channels;
+        std::fill(chunk, chunk + samples, 0.0f);
+
+        Buffer scratch(m_scratch.get(), {m_format.channels, frames});
+        for (auto &decoder : m_decoders)
+        {
+            if (decoder->is_paused())
+            {
+                continue;
+            }
+            decoder->pull(scratch);
+            const float* source = scratch;
+            for (size_t i = 0; i < samples; ++i)
+            {
+                chunk[i] += source[i];
+            }
+        }
+
+        m_decodedFrames.store(decoded + frames, std::memory_order_release);
+        return true;
+    }
+
+    int64_t SegmentSource::get_decoded_frames()
+    {
+        return m_decodedFrames.load(std::memory_order_acquire);
+    }
+
+    void SegmentSource::fade_out()
+    {
+        m_fadeOut.store(true, std::memory_order_release);
+    }
+
+    StreamFormat SegmentSource::get_format()
+    {
+        return m_format;
+    }
+
+    void SegmentSource::pull(Buffer& buffer)
+    {
+        float* buf = buffer;
+        auto info = buffer.get_info();
+
+        if (m_fadeOutStart < 0 && m_fadeOut.load(std::memory_order_acquire))
+        {
+            m_fadeOutStart = m_position;
+        }
+
+        // Frames the worker has not decoded yet play as silence rather than blocking.
+        int64_t available = m_decodedFrames.load(std::memory_order_acquire) - m_position;
+        int64_t frames = std::max<int64_t>(0, std::min<int64_t>(info.frames, available));
+
+        // The decoded audio is in the source layout, map it to the buffer's before fading.
+        const float* start = m_pcm.get() + (m_position * m_format.channels);
+        map_channels(buf, info.channels, start, m_format.channels, static_cast<int>(frames));
+        for (int64_t i = 0; i < frames; ++i)
+        {
+            int64_t frame = m_position + i;
+            int64_t fade = std::min(frame, m_totalFrames - frame);
+            if (m_fadeOutStart >= 0)
+            {
+                fade = std::min(fade, m_fadeFrames - (frame - m_fadeOutStart));
+            }
+            float gain = fade >= m_fadeFrames ? 1.0f : std::max<int64_t>(fade, 0) / static_cast<float>(m_fadeFrames);
+
+            for (int c = 0; c < info.channels; ++c)
+            {
+                buf[(i * info.channels) + c] *= gain;
+            }
+        }
+        std::fill(buf + (frames * info.channels), buf + buffer.size(), 0.0f);
+
+        // A segment that is faded out early may never be fully decoded, it ends wherever the decoded audio runs out.
+        m_position += frames;
+        if (m_position >= m_totalFrames ||
+            (m_fadeOutStart >= 0 && (m_position - m_fadeOutStart >= m_fadeFrames || frames < info.frames)))
+        {
+            set_pause(true);
+        }
+        set_time(m_position / static_cast<double>(m_format.sampleRate));
+    }
+}
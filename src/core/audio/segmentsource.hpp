@@ -0,0 +1,61 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+#include "decodersource.hpp"
+#include "decoderpool.hpp"
+
+namespace ORCore
+{
+    // Plays a short segment of a set of files mixed together, such as the stems of a song for a preview.
+    // Only the segment is decoded, into memory, by calling decode_step() from a worker thread.
+    // Playback can start as soon as the first step is done since decoding runs far faster than realtime.
+    // The segment fades in and out, fade_out() ends it early with the same fade so two segments can crossfade.
+    class SegmentSource: public ProducerStream, public DecodeTask
+    {
+    public:
+        // Files with a different format than the first are left out of the mix.
+        // Throws std::runtime_error if a file can't be opened.
+        SegmentSource(std::vector<std::string> filenames, double start, double length, double fadeTime);
+
+        // Length of the full first file, so a start position can be picked after opening.
+        double get_file_length();
+
+        // Move the segment, only valid before the first decode_step().
+        void set_start(double start);
+
+        // Decodes the next chunk of the segment, returns false once the whole segment is decoded.
+        bool decode_step();
+        int64_t get_decoded_frames();
+
+        // Can be called from any thread, the source pauses once the fade finishes.
+        void fade_out();
+
+        StreamFormat get_format();
+        void pull(Buffer& buffer);
+
+    private:
+        std::vector<std::unique_ptr<DecoderSource>> m_decoders;
+        StreamFormat m_format;
+        int64_t m_segmentFrames;
+        int64_t m_totalFrames;
+        int64_t m_fadeFrames;
+
+        AlignedFloats m_pcm;
+        AlignedFloats m_scratch;
+        std::atomic<int64_t> m_decodedFrames;
+        std::atomic_bool m_fadeOut;
+
+        // Only used by the audio thread.
+        int64_t m_position;
+        int64_t m_fadeOutStart;
+    };
+}
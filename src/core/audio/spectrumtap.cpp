@@ -0,0 +1,274 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "spectrumtap.hpp"
+
+namespace ORCore
+{
+    const double pi = 3.14159265358979323846;
+
+    // 1024 frames is about 23ms at 44.1kHz, a new frame every hop is faster than any display refresh.
+    const int spectrumSize = 1024;
+    const int spectrumHop = 512;
+    const double spectrumMinFrequency = 40.0;
+    const double spectrumMaxFrequency = 16000.0;
+
+    // Anything quieter than this reads as this.
+    const float spectrumFloor = -100.0f;
+
+    // A band has an onset when it rises well over its recent average rise, measured in dB.
+    // The average adapts over roughly a quarter second of hops.
+    const float onsetRatio = 3.0f;
+    const float onsetMinRise = 6.0f;
+    const float onsetMinLevel = -60.0f;
+    const float fluxSmoothing = 0.1f;
+
+    // Rises are measured from a peak hold that falls this many dB a hop, so a band flickering around
+    // a steady level, like a single bin of noise, doesn't read as a series of attacks.
+    const float peakDecay = 0.5f;
+
+    const std::chrono::milliseconds spectrumPollInterval(1);
+
+    SpectrumTap::SpectrumTap(int maxBlockFrames)
+    : m_stream(nullptr),
+    m_format({44100, 2}),
+    m_maxBlockFrames(maxBlockFrames),
+    m_position(0),
+    m_fft(spectrumSize),
+    m_totalFluxMean(0.0f),
+    m_totalWasOver(false),
+    m_historyPos(0),
+    m_newFrames(0),
+    m_lastPosition(0),
+    m_frame(),
+    m_running(false)
+    {
+    }
+
+    SpectrumTap::~SpectrumTap()
+    {
+        stop();
+    }
+
+    bool SpectrumTap::add_source(Stream* stream)
+    {
+        stop();
+
+        m_stream = stream;
+        m_format = m_stream->get_format();
+
+        // All memory used while pulling or analyzing is allocated here.
+        TapBlock block;
+        block.samples.resize(static_cast<size_t>(m_maxBlockFrames) * m_format.channels);
+        block.frames = 0;
+        block.channels = m_format.channels;
+        block.position = 0;
+        m_blocks = std::make_unique<TripleBuffer<TapBlock>>(block);
+
+        m_history = make_aligned_floats(spectrumSize);
+        m_window = make_aligned_floats(spectrumSize);
+        m_real = make_aligned_floats(spectrumSize);
+        m_imag = make_aligned_floats(spectrumSize);
+        std::fill(m_history.get(), m_history.get() + spectrumSize, 0.0f);
+        for (int i = 0; i < spectrumSize; ++i)
+        {
+            m_window[i] = static_cast<float>(0.5 - (0.5 * std::cos((2.0 * pi * i) / spectrumSize)));
+        }
+
+        // Each band gets at least one bin, the lowest bands are wider than asked for at low sample rates.
+        int bins = spectrumSize / 2;
+        double binWidth = static_cast<double>(m_format.sampleRate) / spectrumSize;
+        double maxFrequency = std::min(spectrumMaxFrequency, m_format.sampleRate / 2.0);
+        m_bandStart.assign(spectrumBands + 1, 0);
+        for (int band = 0; band <= spectrumBands; ++band)
+        {
+            double frequency = spectrumMinFrequency *
+                std::pow(maxFrequency / spectrumMinFrequency, static_cast<double>(band) / spectrumBands);
+            int bin = static_cast<int>(std::lround(frequency / binWidth));
+            if (band > 0)
+            {
+                bin = std::max(bin, m_bandStart[band - 1] + 1);
+            }
+            m_bandStart[band] = std::min(std::max(bin, 1), bins);
+        }
+
+        m_peak.assign(spectrumBands, spectrumFloor);
+        m_fluxMean.assign(spectrumBands, 0.0f);
+        m_wasOver.assign(spectrumBands, 0);
+        m_totalFluxMean = 0.0f;
+        m_totalWasOver = false;
+        m_historyPos = 0;
+        m_newFrames = 0;
+        m_lastPosition = 0;
+        m_position = 0;
+        m_frame = SpectrumFrame();
+        return true;
+    }
+
+    void SpectrumTap::pull(Buffer& buffer)
+    {
+        m_stream->pull(buffer);
+
+        const float* buf = buffer;
+        auto info = buffer.get_info();
+        TapBlock& block = m_blocks->get_write_slot();
+
+        int frames = std::min(info.frames, static_cast<int>(block.samples.size() / info.channels));
+        int skipped = info.frames - frames;
+        std::memcpy(block.samples.data(), buf + (skipped * info.channels), frames * info.channels * sizeof(float));
+        block.frames = frames;
+        block.channels = info.channels;
+        block.position = m_position + skipped;
+        m_blocks->publish();
+
+        m_position += info.frames;
+    }
+
+    StreamFormat SpectrumTap::get_format()
+    {
+        return m_stream->get_format();
+    }
+
+    bool SpectrumTap::is_paused()
+    {
+        return m_stream == nullptr || m_stream->is_paused();
+    }
+
+    void SpectrumTap::start()
+    {
+        if (m_running.exchange(true))
+        {
+            return;
+        }
+        m_thread = std::thread(&SpectrumTap::analysis_loop, this);
+    }
+
+    void SpectrumTap::stop()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    void SpectrumTap::analysis_loop()
+    {
+        while (m_running.load(std::memory_order_acquire))
+        {
+            if (!analyze())
+            {
+                std::this_thread::sleep_for(spectrumPollInterval);
+            }
+        }
+    }
+
+    bool SpectrumTap::analyze()
+    {
+        if (!m_blocks->update())
+        {
+            return false;
+        }
+
+        const TapBlock& block = m_blocks->get_read_slot();
+        float scale = 1.0f / block.channels;
+        float* history = m_history.get();
+        const float* frame = block.samples.data();
+        for (int i = 0; i < block.frames; ++i)
+        {
+            float sum = 0.0f;
+            for (int c = 0; c < block.channels; ++c)
+            {
+                sum += frame[c];
+            }
+            history[m_historyPos] = sum * scale;
+            m_historyPos = (m_historyPos + 1) % spectrumSize;
+            frame += block.channels;
+        }
+
+        // Skipped blocks count towards the hop so a slow reader still analyzes the newest audio.
+        uint64_t end = block.position + block.frames;
+        m_newFrames += static_cast<int>(std::min<uint64_t>(end - m_lastPosition, spectrumSize));
+        m_lastPosition = end;
+        if (m_newFrames < spectrumHop)
+        {
+            return false;
+        }
+        m_newFrames = 0;
+
+        m_frame.time = static_cast<double>(end) / m_format.sampleRate;
+        analyze_window();
+
+        m_frames.get_write_slot() = m_frame;
+        m_frames.publish();
+        return true;
+    }
+
+    void SpectrumTap::analyze_window()
+    {
+        float* real = m_real.get();
+        float* imag = m_imag.get();
+        const float* history = m_history.get();
+        const float* window = m_window.get();
+
+        // The history is circular, the oldest frame is the next one to be written.
+        for (int i = 0; i < spectrumSize; ++i)
+        {
+            real[i] = history[(m_historyPos + i) % spectrumSize] * window[i];
+        }
+        std::fill(imag, imag + spectrumSize, 0.0f);
+        m_fft.forward(real, imag);
+
+        // A full scale sine puts N * sum(window^2) / 4 into the positive bins.
+        double reference = spectrumSize * (spectrumSize * 0.375) / 4.0;
+
+        float totalFlux = 0.0f;
+        for (int band = 0; band < spectrumBands; ++band)
+        {
+            double energy = 0.0;
+            for (int bin = m_bandStart[band]; bin < m_bandStart[band + 1]; ++bin)
+            {
+                energy += (static_cast<double>(real[bin]) * real[bin]) + (static_cast<double>(imag[bin]) * imag[bin]);
+            }
+
+            float level = static_cast<float>(10.0 * std::log10((energy / reference) + 1e-12));
+            level = std::max(level, spectrumFloor);
+            m_frame.bands[band] = level;
+
+            // Only rises count, and only the first window of a rise so one attack is one onset.
+            float flux = std::max(0.0f, level - m_peak[band]);
+            bool over = level > onsetMinLevel && flux > onsetMinRise && flux > m_fluxMean[band] * onsetRatio;
+            if (over && !m_wasOver[band])
+            {
+                m_frame.bandOnsets[band]++;
+            }
+            m_wasOver[band] = over;
+            m_fluxMean[band] += (flux - m_fluxMean[band]) * fluxSmoothing;
+            m_peak[band] = std::max(level, m_peak[band] - peakDecay);
+            totalFlux += flux;
+        }
+
+        totalFlux /= spectrumBands;
+        bool over = totalFlux > onsetMinRise / 2.0f && totalFlux > m_totalFluxMean * onsetRatio;
+        if (over && !m_totalWasOver)
+        {
+            m_frame.onsets++;
+        }
+        m_totalWasOver = over;
+        m_totalFluxMean += (totalFlux - m_totalFluxMean) * fluxSmoothing;
+    }
+
+    bool SpectrumTap::read(SpectrumFrame& frame)
+    {
+        if (!m_frames.update())
+        {
+            return false;
+        }
+        frame = m_frames.get_read_slot();
+        return true;
+    }
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cstdint>
+
+#include "streams.hpp"
+#include "aligned.hpp"
+#include "triplebuffer.hpp"
+#include "fft.hpp"
+
+namespace ORCore
+{
+    // Bands are spaced evenly in log frequency between spectrumMinFrequency and spectrumMaxFrequency.
+    const int spectrumBands = 16;
+
+    struct SpectrumFrame
+    {
+        // Seconds of audio pulled through the tap at the end of the analyzed window.
+        double time;
+
+        // Energy of each band in dB relative to a full scale sine.
+        float bands[spectrumBands];
+
+        // Onsets counted so far in each band and across the whole spectrum.
+        // Counters rather than flags so a reader that skips frames still sees every onset,
+        // an onset happened if the count changed since the last frame read.
+        uint32_t bandOnsets[spectrumBands];
+        uint32_t onsets;
+    };
+
+    // Analysis tap for visualizers, usually on the master mix.
+    // Pulling passes audio through and copies the block into a lock-free triple buffer, nothing else.
+    // An analysis thread takes the newest block, runs an FFT over the latest window every hop
+    // and publishes band energies and onset counters through a second triple buffer the renderer reads.
+    // Analysis only ever looks at the newest audio, blocks it didn't get to in time are skipped.
+    class SpectrumTap: public InputStream
+    {
+    public:
+        // Pulls larger than maxBlockFrames only keep their last maxBlockFrames frames for analysis.
+        SpectrumTap(int maxBlockFrames = 4096);
+        ~SpectrumTap();
+
+        bool add_source(Stream* stream);
+        void pull(Buffer& buffer);
+        StreamFormat get_format();
+
+        bool is_paused();
+
+        // Run analyze() on a dedicated thread until stop() or destruction.
+        void start();
+        void stop();
+
+        // Analyze the newest block if there is one, returns true if a new frame was published.
+        // Only one thread may analyze at a time.
+        bool analyze();
+
+        // Copies the newest frame, returns false if nothing new was published since the last read.
+        // Never blocks, only one thread may read.
+        bool read(SpectrumFrame& frame);
+
+    private:
+        struct TapBlock
+        {
+            std::vector<float> samples;
+            int frames;
+            int channels;
+            uint64_t position;
+        };
+
+        void analysis_loop();
+        void analyze_window();
+
+        Stream* m_stream;
+        StreamFormat m_format;
+        int m_maxBlockFrames;
+
+        // Only used by the audio thread.
+        uint64_t m_position;
+
+        std::unique_ptr<TripleBuffer<TapBlock>> m_blocks;
+        TripleBuffer<SpectrumFrame> m_frames;
+
+        // Only used by the analysis thread.
+        Fft m_fft;
+        AlignedFloats m_history;
+        AlignedFloats m_window;
+        AlignedFloats m_real;
+        AlignedFloats m_imag;
+        std::vector<int> m_bandStart;
+        std::vector<float> m_peak;
+        std::vector<float> m_fluxMean;
+        std::vector<char> m_wasOver;
+        float m_totalFluxMean;
+        bool m_totalWasOver;
+        int m_historyPos;
+        int m_newFrames;
+        uint64_t m_lastPosition;
+        SpectrumFrame m_frame;
+
+        std::atomic_bool m_running;
+        std::thread m_thread;
+    };
+}
@@ -5,6 +5,7 @@
 #include <memory>
 #include <atomic>
 #include <algorithm>
+#include <cstdint>
 
 #include "buffer.hpp"
 
@@ -17,6 +18,28 @@ namespace ORCore
         int channels;
     };
 
+    class Stream;
+
+    enum class CommandType
+    {
+        pause,
+        resume,
+        seek,    // value is the time in seconds.
+        gain,    // value is the linear gain of input on a mixer.
+        speed,   // value is the speed multiplier.
+        cancel,  // Drops every pending command for the target, used before a stream is destroyed.
+    };
+
+    // A control change applied to target when the mixer timeline reaches frame.
+    struct StreamCommand
+    {
+        CommandType type;
+        int64_t frame;
+        Stream* target;
+        Stream* input;
+        double value;
+    };
+
     // Stream defines the basic interface that is needed between pipeline stages.
     // Everything else added ontop of this will be primarally for setup and control purposes.
     class Stream
@@ -36,6 +59,12 @@ namespace ORCore
         // Some streams will always be `false` such as mixers.
         // When a stream is paused its pull should not be called, and the buffer should be zerod.
         virtual bool is_paused() = 0;
+
+        // Called on the audio thread for commands sent through a CommandQueue, between two pulls.
+        // Streams that react to commands override this, everything else ignores them.
+        virtual void apply_command(const StreamCommand& command)
+        {
+        }
     };
 
     // InputStream is a stream with one more source streams.
@@ -74,6 +103,29 @@ namespace ORCore
             m_paused.store(pause, std::memory_order_release);
         }
 
+        // Producers that cannot seek can just ignore this.
+        virtual void seek(double time)
+        {
+        }
+
+        void apply_command(const StreamCommand& command)
+        {
+            switch (command.type)
+            {
+                case CommandType::pause:
+                    set_pause(true);
+                    break;
+                case CommandType::resume:
+                    set_pause(false);
+                    break;
+                case CommandType::seek:
+                    seek(command.value);
+                    break;
+                default:
+                    break;
+            }
+        }
+
     protected:
         std::atomic_bool m_paused;
         std::atomic<double> m_time;
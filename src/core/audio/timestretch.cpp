@@ -1,17 +1,25 @@
 // Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
 // See LICENSE in the project root for license information.
 
-#include <iostream>
+#include <algorithm>
 #include "timestretch.hpp"
+#include "rtlog.hpp"
 
 namespace ORCore
 {
 
-    TimeStretch::TimeStretch()
+    TimeStretch::TimeStretch(int maxLatency, int blockFrames)
+    : m_stream(nullptr),
+    m_format({0, 0}),
+    m_blockFrames(blockFrames),
+    m_maxLatency(maxLatency),
+    m_currentSpeed(1.0f),
+    m_speed(1.0f),
+    m_speedChanged(false),
+    m_latency(0),
+    m_underruns(0)
     {
         m_soundtouchInstance = soundtouch_create();
-        m_speed.store(0.0, std::memory_order_release);
-        m_speed.store(false, std::memory_order_release);
     }
 
     TimeStretch::~TimeStretch()
@@ -22,19 +30,31 @@ namespace ORCore
 
     void TimeStretch::set_speed(float speed)
     {
-        m_speedChanged.store(true, std::memory_order_release);
         m_speed.store(speed, std::memory_order_release);
+        m_speedChanged.store(true, std::memory_order_release);
+    }
+
+    void TimeStretch::apply_command(const StreamCommand& command)
+    {
+        if (command.type == CommandType::speed)
+        {
+            set_speed(static_cast<float>(command.value));
+        }
     }
 
     bool TimeStretch::add_source(Stream* stream)
     {
         m_stream = stream;
 
-        StreamFormat format = m_stream->get_format();
-        
+        m_format = m_stream->get_format();
+
+        // All memory used while pulling is allocated here rather than on the audio thread.
+        m_inputBuffer = make_aligned_floats(static_cast<size_t>(m_blockFrames) * m_format.channels);
+
         // Setup format specific soundtouch info.
-        soundtouch_setChannels(m_soundtouchInstance, format.channels);
-        soundtouch_setSampleRate(m_soundtouchInstance, format.sampleRate);
+        soundtouch_setChannels(m_soundtouchInstance, m_format.channels);
+        soundtouch_setSampleRate(m_soundtouchInstance, m_format.sampleRate);
+        soundtouch_setTempo(m_soundtouchInstance, m_currentSpeed);
         soundtouch_clear(m_soundtouchInstance); // In case there was a previous stream.
 
         return true;
@@ -42,37 +62,63 @@ namespace ORCore
 
     void TimeStretch::pull(Buffer& buffer)
     {
-        buffer.clear();// clear output buffer
         float* buf = buffer;
+        auto info = buffer.get_info();
+        unsigned int frames = static_cast<unsigned int>(info.frames);
+
+        // Speed changes only ever happen between blocks.
+        if (m_speedChanged.exchange(false, std::memory_order_acq_rel))
+        {
+            m_currentSpeed = m_speed.load(std::memory_order_acquire);
+            soundtouch_setTempo(m_soundtouchInstance, m_currentSpeed);
+        }
 
-        Buffer tempBuffer(buffer.get_info());
-        tempBuffer.clear();
-        float* tempbuf = tempBuffer;
+        // We want to only pull samples if the stream isn't paused.
+        if (m_stream->is_paused())
+        {
+            buffer.clear();
+            return;
+        }
 
-        float speedChanged = m_speedChanged.load(std::memory_order_acquire);
+        Buffer inputBuffer(m_inputBuffer.get(), {m_format.channels, m_blockFrames});
+        unsigned int maxLatency = static_cast<unsigned int>(m_maxLatency);
 
-        if (speedChanged)
+        // Soundtouch works in frames (samples per channel).
+        // The amount of data queued inside soundtouch is capped so a single pull has a bounded cost.
+        while (soundtouch_numSamples(m_soundtouchInstance) < frames &&
+               soundtouch_numSamples(m_soundtouchInstance) + soundtouch_numUnprocessedSamples(m_soundtouchInstance) < maxLatency)
         {
-            float speed = m_speed.load(std::memory_order_acquire) * 100.0f;
-            soundtouch_setTempoChange(m_soundtouchInstance, speed);
+            m_stream->pull(inputBuffer);
+            soundtouch_putSamples(m_soundtouchInstance, inputBuffer, static_cast<unsigned int>(m_blockFrames));
         }
 
-        // We want to only pull samples if the stream isn't paused.
-        if (!m_stream->is_paused())
+        unsigned int received = soundtouch_receiveSamples(m_soundtouchInstance, buf, frames);
+
+        if (received < frames)
         {
-            do
-            {
-                m_stream->pull(tempBuffer);
-                soundtouch_putSamples(m_soundtouchInstance, tempbuf, static_cast<unsigned int>(tempBuffer.size()));
-                std::cout << soundtouch_numSamples(m_soundtouchInstance) << " " << soundtouch_numUnprocessedSamples(m_soundtouchInstance) << std::endl;
-            } while(soundtouch_numSamples(m_soundtouchInstance) < static_cast<unsigned int>(buffer.size()));
-
-            soundtouch_receiveSamples(m_soundtouchInstance, buf, static_cast<unsigned int>(buffer.size()));
+            std::fill(buf + (received * info.channels), buf + buffer.size(), 0.0f);
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+            rt_log(RtLogLevel::warn, "Time stretch underrun, {} of {} frames available.", received, frames);
         }
+
+        // Processed output is at the stretched rate, convert it back to source frames.
+        double latency = soundtouch_numUnprocessedSamples(m_soundtouchInstance) +
+                         (soundtouch_numSamples(m_soundtouchInstance) * m_currentSpeed);
+        m_latency.store(static_cast<int>(latency), std::memory_order_release);
     }
 
     StreamFormat TimeStretch::get_format()
     {
         return m_stream->get_format();
     }
-}
\ No newline at end of file
+
+    int TimeStretch::get_latency()
+    {
+        return m_latency.load(std::memory_order_acquire);
+    }
+
+    uint64_t TimeStretch::get_underruns()
+    {
+        return m_underruns.load(std::memory_order_relaxed);
+    }
+}
@@ -4,10 +4,12 @@
 #pragma once
 #include <vector>
 #include <atomic>
+#include <cstdint>
 
 #include <soundtouch-c.h>
 
 #include "streams.hpp"
+#include "aligned.hpp"
 
 
 namespace ORCore
@@ -15,13 +17,27 @@ namespace ORCore
     class TimeStretch: public InputStream
     {
     public:
-        TimeStretch();
+        // maxLatency bounds how many frames may be queued inside the stretcher.
+        // blockFrames is the size of each pull from the source stream.
+        TimeStretch(int maxLatency = 8192, int blockFrames = 512);
         ~TimeStretch();
+
+        // speed is a multiplier, 1.0 is normal speed. Applied at the start of the next pulled block.
         void set_speed(float speed);
+
+        // Speed commands take effect from the frame they are scheduled for.
+        void apply_command(const StreamCommand& command);
         bool add_source(Stream* stream);
         void pull(Buffer& buffer);
         StreamFormat get_format();
 
+        // Number of source frames currently held inside the stretcher.
+        // The song clock should subtract this from the source time.
+        int get_latency();
+
+        // Number of pulls that could not be filled without going over the max latency.
+        uint64_t get_underruns();
+
         // Effect will never be paused.
         bool is_paused()
         {
@@ -32,8 +48,16 @@ namespace ORCore
     private:
         Stream* m_stream;
         ST_INSTANCE m_soundtouchInstance;
+        StreamFormat m_format;
+
+        AlignedFloats m_inputBuffer;
+        int m_blockFrames;
+        int m_maxLatency;
+        float m_currentSpeed;
 
         std::atomic<float> m_speed;
         std::atomic_bool m_speedChanged;
+        std::atomic<int> m_latency;
+        std::atomic<uint64_t> m_underruns;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <atomic>
+
+namespace ORCore
+{
+    // Lock-free single producer, single consumer triple buffer.
+    // The writer fills its own slot and publishes it, the reader takes the most recently published slot.
+    // Neither side ever waits, values published while the reader isn't looking are replaced by newer ones.
+    // Slots are reused rather than reset, so the writer must fill every field of its slot before publishing.
+    template<typename T>
+    class TripleBuffer
+    {
+    public:
+        // Every slot starts as a copy of initial, which is how slots with buffers get allocated up front.
+        TripleBuffer(const T& initial = T());
+
+        // Writer side.
+        T& get_write_slot();
+        void publish();
+
+        // Reader side. Returns true if a newer slot was published since the last update.
+        bool update();
+        T& get_read_slot();
+
+    private:
+        static const int dirtyBit = 4;
+        static const int indexMask = 3;
+
+        T m_slots[3];
+
+        // The slot between the two sides, with dirtyBit set if it was published but not yet read.
+        char m_pad0[64];
+        std::atomic<int> m_middle;
+        char m_pad1[64];
+        int m_writeIndex;
+        char m_pad2[64];
+        int m_readIndex;
+    };
+
+    template<typename T>
+    TripleBuffer<T>::TripleBuffer(const T& initial)
+    : m_slots{initial, initial, initial}, m_middle(1), m_writeIndex(0), m_readIndex(2)
+    {
+    }
+
+    template<typename T>
+    T& TripleBuffer<T>::get_write_slot()
+    {
+        return m_slots[m_writeIndex];
+    }
+
+    template<typename T>
+    void TripleBuffer<T>::publish()
+    {
+        m_writeIndex = m_middle.exchange(m_writeIndex | dirtyBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    template<typename T>
+    bool TripleBuffer<T>::update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & dirtyBit) == 0)
+        {
+            return false;
+        }
+        m_readIndex = m_middle.exchange(m_readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    template<typename T>
+    T& TripleBuffer<T>::get_read_slot()
+    {
+        return m_slots[m_readIndex];
+    }
+}
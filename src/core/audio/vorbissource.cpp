@@ -5,6 +5,7 @@
 #include <iostream>
 
 #include "vorbissource.hpp"
+#include "kernels.hpp"
 
 namespace ORCore
 {
@@ -21,7 +22,7 @@ namespace ORCore
     };
 
     VorbisSource::VorbisSource(std::string filename)
-    : m_filename(filename)
+    : m_filename(filename), m_timeSeek(-1.0)
     {
         set_pause(false);
         int vorbisError = ov_fopen(m_filename.c_str(), &m_vorbisFile);
@@ -47,6 +48,11 @@ namespace ORCore
     }
 
 
+    int64_t VorbisSource::get_frame_count()
+    {
+        return static_cast<int64_t>(ov_pcm_total(&m_vorbisFile, -1));
+    }
+
     VorbisSource::~VorbisSource()
     {
         ov_clear(&m_vorbisFile);
@@ -69,12 +75,20 @@ namespace ORCore
 
         float *buff = buffer;
 
+        // Apply any pending seek before reading so the data pulled is from the new position.
+        double seekTime = m_timeSeek.exchange(-1.0, std::memory_order_acq_rel);
+        if (seekTime >= 0.0)
+        {
+            ov_time_seek(&m_vorbisFile, seekTime);
+        }
+
         while(framesRead < bufferInfo.frames)
         {
             // The buffer format returned from `ov_read_float` is not interleaved.
             // Its instead it is `buffer[channel][sample]`
             // This requires us to interleave the buffer ourselfs when copying
-            // to the output buffer.
+            // to the output buffer, which the vectorized interleave kernel handles.
+            // Buffers with another channel count get the channels mapped instead.
 
             // samplesRead is samples per channel read aka # of frames.
 
@@ -87,27 +101,18 @@ namespace ORCore
                 throw std::runtime_error(errorCodeMap[samplesRead]);
             }
 
-            // if we have reached the end of the file pause the stream.
+            // if we have reached the end of the file pause the stream and silence the rest of the buffer.
             if (samplesRead == 0)
             {
                 set_pause(true);
+                std::fill(buff + (framesRead * bufferInfo.channels), buff + buffer.size(), 0.0f);
+                break;
             }
 
-            for (auto c = 0; c < m_info->channels; c++)
-            {
-                for (auto s = 0; s < samplesRead; s++)
-                {
-                    buff[((framesRead+s)*bufferInfo.channels)+c] = frameData[c][s];
-                }
-            }
+            interleave_mapped(buff + (framesRead * bufferInfo.channels), bufferInfo.channels,
+                              frameData, m_info->channels, samplesRead);
             framesRead += samplesRead;
         }
-        if (m_timeSeek >= 0.0)
-        {
-            double newtime = m_timeSeek.load(std::memory_order_acquire);
-            ov_time_seek(&m_vorbisFile, newtime);
-            m_timeSeek.store(-1.0, std::memory_order_release);
-        }
         set_time(ov_time_tell(&m_vorbisFile));
         
     }
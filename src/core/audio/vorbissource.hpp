@@ -3,14 +3,15 @@
 
 #pragma once
 #include <string>
+#include <cstdint>
 
 #include <vorbis/vorbisfile.h>
 
-#include "streams.hpp"
+#include "decodersource.hpp"
 
 namespace ORCore
 {
-    class VorbisSource: public ProducerStream
+    class VorbisSource: public DecoderSource
     {
     public:
         VorbisSource(std::string filename);
@@ -21,6 +22,7 @@ namespace ORCore
         void pull(Buffer& buffer);
         void seek(double time);
         double get_length();
+        int64_t get_frame_count();
 
     private:
         std::string m_filename;
@@ -0,0 +1,247 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include "wavsource.hpp"
+#include "kernels.hpp"
+
+namespace ORCore
+{
+    const uint16_t wavFormatPcm = 0x0001;
+    const uint16_t wavFormatFloat = 0x0003;
+    const uint16_t wavFormatExtensible = 0xFFFE;
+
+    // Frames converted at a time when the pulled buffer has a different channel count than the file.
+    const int wavMapFrames = 256;
+
+    // Wav files are always little endian.
+    static uint16_t read_u16(const unsigned char* data)
+    {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    static uint32_t read_u32(const unsigned char* data)
+    {
+        return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+               (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    // Convert count interleaved samples from the file to float.
+    static void convert_samples(float* dst, const unsigned char* src, size_t count, WavSampleType type)
+    {
+        switch (type)
+        {
+            case WavSampleType::uint8:
+                for (size_t i = 0; i < count; ++i)
+                {
+                    dst[i] = (src[i] - 128) * (1.0f / 128.0f);
+                }
+                break;
+            case WavSampleType::int16:
+                for (size_t i = 0; i < count; ++i)
+                {
+                    dst[i] = static_cast<int16_t>(read_u16(src + (i * 2))) * (1.0f / 32768.0f);
+                }
+                break;
+            case WavSampleType::int24:
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const unsigned char* sample = src + (i * 3);
+                    int32_t value = static_cast<int32_t>((sample[0] << 8) | (sample[1] << 16) |
+                                                         (static_cast<uint32_t>(sample[2]) << 24)) >> 8;
+                    dst[i] = value * (1.0f / 8388608.0f);
+                }
+                break;
+            case WavSampleType::int32:
+                for (size_t i = 0; i < count; ++i)
+                {
+                    dst[i] = static_cast<int32_t>(read_u32(src + (i * 4))) * (1.0f / 2147483648.0f);
+                }
+                break;
+            case WavSampleType::float32:
+                // Native endian floats, like the pcm cache files.
+                std::memcpy(dst, src, count * sizeof(float));
+                break;
+            case WavSampleType::float64:
+                for (size_t i = 0; i < count; ++i)
+                {
+                    double value;
+                    std::memcpy(&value, src + (i * 8), sizeof(value));
+                    dst[i] = static_cast<float>(value);
+                }
+                break;
+        }
+    }
+
+    WavSource::WavSource(std::string filename)
+    : m_file(filename),
+    m_format({0, 0}),
+    m_sampleType(WavSampleType::int16),
+    m_bytesPerSample(2),
+    m_data(nullptr),
+    m_frames(0),
+    m_seekFrame(-1),
+    m_position(0)
+    {
+        parse();
+        m_mapBuffer = make_aligned_floats(static_cast<size_t>(wavMapFrames) * m_format.channels);
+        set_pause(false);
+        set_time(0.0);
+    }
+
+    void WavSource::parse()
+    {
+        const unsigned char* file = reinterpret_cast<const unsigned char*>(m_file.data());
+        size_t size = m_file.size();
+
+        if (size < 12 || std::memcmp(file, "RIFF", 4) != 0 || std::memcmp(file + 8, "WAVE", 4) != 0)
+        {
+            throw std::runtime_error("Wav: Not a RIFF/WAVE file.");
+        }
+
+        uint16_t format = 0;
+        int bits = 0;
+        size_t dataSize = 0;
+        size_t offset = 12;
+
+        while (offset + 8 <= size)
+        {
+            const unsigned char* chunk = file + offset;
+            size_t chunkSize = std::min<size_t>(read_u32(chunk + 4), size - offset - 8);
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+            {
+                format = read_u16(chunk + 8);
+                m_format.channels = read_u16(chunk + 10);
+                m_format.sampleRate = static_cast<int>(read_u32(chunk + 12));
+                bits = read_u16(chunk + 22);
+
+                // The real format is the first two bytes of the sub format guid.
+                if (format == wavFormatExtensible && chunkSize >= 40)
+                {
+                    format = read_u16(chunk + 32);
+                }
+            }
+            else if (std::memcmp(chunk, "data", 4) == 0)
+            {
+                m_data = chunk + 8;
+                dataSize = chunkSize;
+            }
+
+            // Chunks are padded to an even size.
+            offset += 8 + chunkSize + (chunkSize & 1);
+        }
+
+        if (m_data == nullptr || m_format.channels <= 0 || m_format.sampleRate <= 0)
+        {
+            throw std::runtime_error("Wav: Missing fmt or data chunk.");
+        }
+
+        if (format == wavFormatPcm && bits == 8)
+        {
+            m_sampleType = WavSampleType::uint8;
+        }
+        else if (format == wavFormatPcm && bits == 16)
+        {
+            m_sampleType = WavSampleType::int16;
+        }
+        else if (format == wavFormatPcm && bits == 24)
+        {
+            m_sampleType = WavSampleType::int24;
+        }
+        else if (format == wavFormatPcm && bits == 32)
+        {
+            m_sampleType = WavSampleType::int32;
+        }
+        else if (format == wavFormatFloat && bits == 32)
+        {
+            m_sampleType = WavSampleType::float32;
+        }
+        else if (format == wavFormatFloat && bits == 64)
+        {
+            m_sampleType = WavSampleType::float64;
+        }
+        else
+        {
+            throw std::runtime_error("Wav: Unsupported sample format.");
+        }
+
+        m_bytesPerSample = bits / 8;
+        m_frames = static_cast<int64_t>(dataSize / (m_bytesPerSample * m_format.channels));
+    }
+
+    StreamFormat WavSource::get_format()
+    {
+        return m_format;
+    }
+
+    void WavSource::pull(Buffer& buffer)
+    {
+        float* buf = buffer;
+        auto info = buffer.get_info();
+
+        int64_t seekFrame = m_seekFrame.exchange(-1, std::memory_order_acq_rel);
+        if (seekFrame >= 0)
+        {
+            m_position = std::min(seekFrame, m_frames);
+        }
+
+        int64_t frames = std::max<int64_t>(0, std::min<int64_t>(info.frames, m_frames - m_position));
+        const unsigned char* src = m_data + (m_position * m_format.channels * m_bytesPerSample);
+        if (info.channels == m_format.channels)
+        {
+            convert_samples(buf, src, static_cast<size_t>(frames) * m_format.channels, m_sampleType);
+        }
+        else
+        {
+            for (int64_t done = 0; done < frames; done += wavMapFrames)
+            {
+                int count = static_cast<int>(std::min<int64_t>(frames - done, wavMapFrames));
+                convert_samples(m_mapBuffer.get(), src + (done * m_format.channels * m_bytesPerSample),
+                                static_cast<size_t>(count) * m_format.channels, m_sampleType);
+                map_channels(buf + (done * info.channels), info.channels, m_mapBuffer.get(), m_format.channels, count);
+            }
+        }
+        std::fill(buf + (frames * info.channels), buf + buffer.size(), 0.0f);
+
+        m_position += frames;
+        if (m_position >= m_frames)
+        {
+            set_pause(true);
+        }
+        set_time(m_position / static_cast<double>(m_format.sampleRate));
+    }
+
+    void WavSource::seek(double time)
+    {
+        m_seekFrame.store(static_cast<int64_t>(std::max(time, 0.0) * m_format.sampleRate), std::memory_order_release);
+    }
+
+    double WavSource::get_length()
+    {
+        return m_frames / static_cast<double>(m_format.sampleRate);
+    }
+
+    int64_t WavSource::get_frame_count()
+    {
+        return m_frames;
+    }
+
+    const float* WavSource::get_samples()
+    {
+        // The mapping itself is page aligned so only the offset of the data chunk matters.
+        if (m_sampleType == WavSampleType::float32 && reinterpret_cast<uintptr_t>(m_data) % alignof(float) == 0)
+        {
+            return reinterpret_cast<const float*>(m_data);
+        }
+        return nullptr;
+    }
+
+    bool WavSource::use_cache_file()
+    {
+        return false;
+    }
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+#include "decodersource.hpp"
+#include "mappedfile.hpp"
+#include "aligned.hpp"
+
+namespace ORCore
+{
+    enum class WavSampleType
+    {
+        uint8,
+        int16,
+        int24,
+        int32,
+        float32,
+        float64,
+    };
+
+    // PCM and float wav files played straight out of a memory mapped file.
+    // Samples are converted from the mapping into the output buffer in one pass,
+    // 32 bit float files are not converted at all and are exposed through get_samples.
+    class WavSource: public DecoderSource
+    {
+    public:
+        // Throws std::runtime_error if the file is not a wav file this can play.
+        WavSource(std::string filename);
+
+        StreamFormat get_format();
+        void pull(Buffer& buffer);
+        void seek(double time);
+        double get_length();
+        int64_t get_frame_count();
+        const float* get_samples();
+        bool use_cache_file();
+
+    private:
+        void parse();
+
+        MappedFile m_file;
+        StreamFormat m_format;
+        WavSampleType m_sampleType;
+        int m_bytesPerSample;
+        const unsigned char* m_data;
+        int64_t m_frames;
+
+        std::atomic<int64_t> m_seekFrame;
+
+        // Only used by the thread pulling.
+        int64_t m_position;
+
+        // Buffers with another channel layout are converted through here then mapped.
+        AlignedFloats m_mapBuffer;
+    };
+}
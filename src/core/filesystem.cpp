@@ -13,6 +13,7 @@
 #   include <shlobj.h>
 #else
 #   include <dirent.h>
+#   include <errno.h>
 #   include <sys/stat.h>
 #   if defined(PLATFORM_OSX)
 #       include <mach-o/dyld.h>
@@ -84,19 +85,26 @@ namespace ORCore
             // return early with empty vector
             return contents;
         }
-        do
+        while ((dp = readdir(dir)) != nullptr)
         {
+            std::string fileName = dp->d_name;
+            if (fileName == "." || fileName == "..")
+            {
+                continue;
+            }
+
             std::string filePath = sysPath;
             filePath += sys_path_delimiter;
-            filePath += dp->d_name;
+            filePath += fileName;
+
+            if (stat(filePath.c_str(), &sb) != 0)
+            {
+                continue;
+            }
 
             FileInfo file;
             file.filePath = std::move(filePath);
-            file.fileName = dp->d_name;
-
-            stat(file.fileName.c_str(), &sb);
-
-            dp = readdir(dir); // This is for next loop iteration
+            file.fileName = std::move(fileName);
 
             if (S_ISDIR(sb.st_mode))
             {
@@ -112,7 +120,6 @@ namespace ORCore
             }
             contents.push_back(std::move(file));
         }
-        while(dp);
         closedir(dir);
         #endif
 
@@ -249,6 +256,52 @@ namespace ORCore
         return homePath;
     }
 
+    bool create_path(std::string sysPath)
+    {
+        size_t pos = 0;
+        do
+        {
+            pos = sysPath.find_first_of("\\/", pos + 1);
+            std::string subPath = sysPath.substr(0, pos);
+            if (subPath.empty())
+            {
+                continue;
+            }
+#if defined(PLATFORM_WINDOWS)
+            if (!CreateDirectory(subPath.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+            {
+                return false;
+            }
+#else
+            if (mkdir(subPath.c_str(), 0755) != 0 && errno != EEXIST)
+            {
+                return false;
+            }
+#endif
+        }
+        while (pos != std::string::npos);
+        return true;
+    }
+
+    int64_t get_modified_time(std::string sysPath)
+    {
+#if defined(PLATFORM_WINDOWS)
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesEx(sysPath.c_str(), GetFileExInfoStandard, &data))
+        {
+            return -1;
+        }
+        return (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+        struct stat sb;
+        if (stat(sysPath.c_str(), &sb) != 0)
+        {
+            return -1;
+        }
+        return static_cast<int64_t>(sb.st_mtime);
+#endif
+    }
+
 #if OSX_APP_BUNDLE
     std::string get_app_path() // OSX get internal app path
     {
@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <cstdint>
 
 // Utility functions for finding paths
 namespace ORCore
@@ -34,6 +35,8 @@ namespace ORCore
     std::string read_file(std::string filename, FileMode mode = FileMode::Normal);
     std::string get_base_path(); // executable path
     std::string get_home_path(); // home/library path to store configs
+    bool create_path(std::string sysPath); // creates any missing folders along the path
+    int64_t get_modified_time(std::string sysPath); // last write time in platform units for comparing, -1 on failure
 
 #if OSX_APP_BUNDLE
     std::string get_app_path(); // OSX get internal app path
@@ -0,0 +1,176 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include "config.hpp"
+#include <stdexcept>
+
+#if !defined(PLATFORM_WINDOWS)
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+#include <fmt/format.h>
+
+#include "mappedfile.hpp"
+
+namespace ORCore
+{
+    MappedFile::MappedFile()
+    : m_data(nullptr), m_size(0)
+#if defined(PLATFORM_WINDOWS)
+    , m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#endif
+    {
+    }
+
+    MappedFile::MappedFile(std::string filename)
+    : MappedFile()
+    {
+        open(filename);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other)
+    : MappedFile()
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other)
+    {
+        if (this != &other)
+        {
+            close();
+            m_data = other.m_data;
+            m_size = other.m_size;
+            other.m_data = nullptr;
+            other.m_size = 0;
+#if defined(PLATFORM_WINDOWS)
+            m_file = other.m_file;
+            m_mapping = other.m_mapping;
+            other.m_file = INVALID_HANDLE_VALUE;
+            other.m_mapping = nullptr;
+#endif
+        }
+        return *this;
+    }
+
+    void MappedFile::open(std::string filename)
+    {
+        close();
+
+#if defined(PLATFORM_WINDOWS)
+        m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error(fmt::format(_("Failed to open {}"), filename));
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_file, &fileSize))
+        {
+            close();
+            throw std::runtime_error(fmt::format(_("Failed to get size of {}"), filename));
+        }
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+
+        // Empty files can't be mapped, treat them as an open file with no data.
+        if (m_size == 0)
+        {
+            return;
+        }
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr)
+        {
+            close();
+            throw std::runtime_error(fmt::format(_("Failed to map {}"), filename));
+        }
+
+        m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr)
+        {
+            close();
+            throw std::runtime_error(fmt::format(_("Failed to map {}"), filename));
+        }
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error(fmt::format(_("Failed to open {}"), filename));
+        }
+
+        struct stat sb;
+        if (fstat(fd, &sb) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error(fmt::format(_("Failed to get size of {}"), filename));
+        }
+        m_size = static_cast<size_t>(sb.st_size);
+
+        if (m_size > 0)
+        {
+            void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                ::close(fd);
+                m_size = 0;
+                throw std::runtime_error(fmt::format(_("Failed to map {}"), filename));
+            }
+            m_data = static_cast<const char*>(mapping);
+        }
+
+        // The mapping keeps its own reference to the file.
+        ::close(fd);
+#endif
+    }
+
+    void MappedFile::close()
+    {
+#if defined(PLATFORM_WINDOWS)
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping != nullptr)
+        {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (m_data != nullptr)
+        {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool MappedFile::is_open()
+    {
+        return m_data != nullptr;
+    }
+
+    const char* MappedFile::data()
+    {
+        return m_data;
+    }
+
+    size_t MappedFile::size()
+    {
+        return m_size;
+    }
+} // namespace ORCore
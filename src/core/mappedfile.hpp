@@ -0,0 +1,49 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include "config.hpp"
+#include <string>
+#include <cstddef>
+
+#if defined(PLATFORM_WINDOWS)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#endif
+
+namespace ORCore
+{
+    // Read-only memory mapped view of a whole file.
+    // The OS pages the file in on demand so nothing is copied up front.
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        MappedFile(std::string filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile& other) = delete;
+        MappedFile& operator=(const MappedFile& other) = delete;
+        MappedFile(MappedFile&& other);
+        MappedFile& operator=(MappedFile&& other);
+
+        // Throws std::runtime_error if the file can't be opened or mapped.
+        void open(std::string filename);
+        void close();
+
+        bool is_open();
+        const char* data();
+        size_t size();
+
+    private:
+        const char* m_data;
+        size_t m_size;
+
+#if defined(PLATFORM_WINDOWS)
+        HANDLE m_file;
+        HANDLE m_mapping;
+#endif
+    };
+} // namespace ORCore
@@ -3,84 +3,157 @@
 
 #pragma once
 #include "config.hpp"
-#include <fstream>
 #include <string>
-#include <memory>
+#include <cstddef>
 #include <stdexcept>
 
+#include "mappedfile.hpp"
+
 
 namespace ORCore
 {
-    // Also in the future we can have an alternative memory mapped file
-    // implementation when speed is less important than memory usage.
-    // This is just mainly a basic starting point.
+    // Bounds checked read cursor over a range of bytes.
+    // Every read checks the remaining length once for the whole value or array,
+    // and sub_span hands out a smaller span so a chunk can't be read past its own end.
+    class FileSpan
+    {
+    public:
+        FileSpan();
+        FileSpan(const char* data, size_t size);
+
+        // Returns the next size bytes and moves past them.
+        // Throws std::runtime_error if fewer than size bytes remain.
+        const char* take(size_t size);
+        const char* peek(size_t size);
+
+        // Splits off the next size bytes as their own span and moves past them.
+        FileSpan sub_span(size_t size);
+
+        size_t get_pos();
+        void set_pos(size_t pos);
+        size_t get_size();
+        size_t remaining();
+        bool empty();
+
+    private:
+        const char* m_begin;
+        const char* m_end;
+        const char* m_cursor;
+    };
+
+    // Memory mapped file, pages are only read in as spans over it are read.
     struct FileBuffer
     {
-        std::unique_ptr<char[]> data;
-        uint32_t position = 0;
-        uint32_t size = 0;
+        MappedFile file;
 
-        void load(std::string filename)
-        {
-            std::ifstream dataFile(filename, std::ios_base::ate | std::ios_base::binary);
+        // Throws std::runtime_error if the file can't be opened or mapped.
+        void load(std::string filename);
+        FileSpan get_span();
+        size_t get_size();
 
-            if (dataFile)
-            {
-                size = dataFile.tellg();
-                data = std::make_unique<char[]>(size);
-                dataFile.seekg(0, std::ios::beg);
+        void release();
+    };
 
-                dataFile.read(&data[0], size);
-                dataFile.close();
-            }
-            else
-            {
-                throw std::runtime_error(_("Failed to load file."));
-            }
-        }
-        uint32_t get_pos()
-        {
-            return position;
-        }
-        void set_pos(uint32_t pos)
-        {
-            position = pos;
-        }
-        void set_pos_rel(uint32_t pos)
-        {
-            position += pos;
-        }
-        uint32_t get_size()
+    // Defined here rather than in a cpp file so the per byte reads of the parsers can be inlined.
+    inline FileSpan::FileSpan()
+    : m_begin(nullptr), m_end(nullptr), m_cursor(nullptr)
+    {
+    }
+
+    inline FileSpan::FileSpan(const char* data, size_t size)
+    : m_begin(data), m_end(data + size), m_cursor(data)
+    {
+    }
+
+    inline const char* FileSpan::take(size_t size)
+    {
+        const char* data = peek(size);
+        m_cursor += size;
+        return data;
+    }
+
+    inline const char* FileSpan::peek(size_t size)
+    {
+        if (size > remaining())
         {
-            return size;
+            throw std::runtime_error(_("Read past the end of the file."));
         }
+        return m_cursor;
+    }
+
+    inline FileSpan FileSpan::sub_span(size_t size)
+    {
+        return FileSpan(take(size), size);
+    }
+
+    inline size_t FileSpan::get_pos()
+    {
+        return static_cast<size_t>(m_cursor - m_begin);
+    }
 
-        void release()
+    inline void FileSpan::set_pos(size_t pos)
+    {
+        if (pos > get_size())
         {
-            data.reset();
+            throw std::runtime_error(_("Read past the end of the file."));
         }
-    };
+        m_cursor = m_begin + pos;
+    }
+
+    inline size_t FileSpan::get_size()
+    {
+        return static_cast<size_t>(m_end - m_begin);
+    }
+
+    inline size_t FileSpan::remaining()
+    {
+        return static_cast<size_t>(m_end - m_cursor);
+    }
+
+    inline bool FileSpan::empty()
+    {
+        return m_cursor == m_end;
+    }
+
+    inline void FileBuffer::load(std::string filename)
+    {
+        file.open(filename);
+    }
+
+    inline FileSpan FileBuffer::get_span()
+    {
+        return FileSpan(file.data(), file.size());
+    }
+
+    inline size_t FileBuffer::get_size()
+    {
+        return file.size();
+    }
+
+    inline void FileBuffer::release()
+    {
+        file.close();
+    }
 
-    // Custom FileBuffer based reading.
+    // Custom FileSpan based reading, all values are big endian.
     template<typename T>
-    T read_type(FileBuffer &fileData)
+    T read_type(FileSpan &fileData)
     {
         T output;
         size_t size = sizeof(T);
 
         char *outPtr = reinterpret_cast<char*>(&output);
-        char *inPtr = &fileData.data[fileData.position];
+        const char *inPtr = fileData.take(size);
 
         for (size_t i = 0; i < size; i++)
         {
             outPtr[i] = inPtr[size-1 - i];
         }
-        fileData.position += size;
         return output;
     }
 
     template<typename T>
-    T read_type(FileBuffer &fileData, size_t size)
+    T read_type(FileSpan &fileData, size_t size)
     {
         T output = 0;
         if (sizeof(output) < size)
@@ -90,46 +163,44 @@ namespace ORCore
         else
         {
             char *outPtr = reinterpret_cast<char*>(&output);
-            char *inPtr = &fileData.data[fileData.position];
+            const char *inPtr = fileData.take(size);
 
             for (size_t i = 0; i < size; i++)
             {
                 outPtr[i] = inPtr[size-1 - i];
             }
-            fileData.position += size;
         }
         return output;
     }
 
     // Main purpose is for reading string-like data from the file.
     template<typename T>
-    void read_type(FileBuffer &fileData, T *output, unsigned long length)
+    void read_type(FileSpan &fileData, T *output, size_t length)
     {
         size_t size = sizeof(T);
 
         char *outPtr = reinterpret_cast<char*>(output);
-        char *inPtr;
+        const char *inPtr = fileData.take(size * length);
 
         for (size_t j = 0; j < length; j++)
         {
-            inPtr = &fileData.data[fileData.position];
             for (size_t i = 0; i < size; i++)
             {
                 outPtr[i] = inPtr[size-1 - i];
             }
             outPtr += size;
-            fileData.position += size;
+            inPtr += size;
         }
     }
 
     template<typename T>
-    T peek_type(FileBuffer &fileData)
+    T peek_type(FileSpan &fileData)
     {
         T output;
         size_t size = sizeof(T);
 
         char *outPtr = reinterpret_cast<char*>(&output);
-        char *inPtr = &fileData.data[fileData.position];
+        const char *inPtr = fileData.peek(size);
 
         for (size_t i = 0; i < size; i++)
         {
@@ -139,7 +210,7 @@ namespace ORCore
     }
 
     template<typename T>
-    T peek_type(FileBuffer &fileData, size_t size)
+    T peek_type(FileSpan &fileData, size_t size)
     {
         T output = 0;
         if (sizeof(output) < size)
@@ -149,7 +220,7 @@ namespace ORCore
         else
         {
             char *outPtr = reinterpret_cast<char*>(&output);
-            char *inPtr = &fileData.data[fileData.position];
+            const char *inPtr = fileData.peek(size);
 
             for (size_t i = 0; i < size; i++)
             {
@@ -161,21 +232,21 @@ namespace ORCore
 
     // Main purpose is for reading string-like data from the file.
     template<typename T>
-    void peek_type(FileBuffer &fileData, T *output, unsigned long length)
+    void peek_type(FileSpan &fileData, T *output, size_t length)
     {
         size_t size = sizeof(T);
 
         char *outPtr = reinterpret_cast<char*>(output);
-        char *inPtr;
+        const char *inPtr = fileData.peek(size * length);
 
         for (size_t j = 0; j < length; j++)
         {
-            inPtr = &fileData.data[fileData.position+(size*j)];
             for (size_t i = 0; i < size; i++)
             {
                 outPtr[i] = inPtr[size-1 - i];
             }
             outPtr += size;
+            inPtr += size;
         }
     }
 } // namespace ORCore
@@ -51,14 +51,14 @@ namespace ORCore
 
     uint32_t SmfReader::read_var_len()
     {
-        uint8_t c = read_type<uint8_t>(m_smfFile);
+        uint8_t c = read_type<uint8_t>(m_chunk);
         uint32_t value = static_cast<uint32_t>(c & 0x7F);
 
         if (c & 0x80)
         {
             do
             {
-                c = read_type<uint8_t>(m_smfFile);
+                c = read_type<uint8_t>(m_chunk);
                 value = (value << 7) + (c & 0x7F);
             }
             while (c & 0x80);
@@ -78,28 +78,28 @@ namespace ORCore
         {
             case NoteOff:      // note off           (2 more bytes)
             case NoteOn:       // note on            (2 more bytes)
-                midiEvent.data1 = read_type<uint8_t>(m_smfFile); // note
-                midiEvent.data2 = read_type<uint8_t>(m_smfFile); // velocity
+                midiEvent.data1 = read_type<uint8_t>(m_chunk); // note
+                midiEvent.data2 = read_type<uint8_t>(m_chunk); // velocity
                 break;
             case KeyPressure:
-                midiEvent.data1 = read_type<uint8_t>(m_smfFile); // note
-                midiEvent.data2 = read_type<uint8_t>(m_smfFile); // pressure
+                midiEvent.data1 = read_type<uint8_t>(m_chunk); // note
+                midiEvent.data2 = read_type<uint8_t>(m_chunk); // pressure
                 break;
             case ControlChange:
-                midiEvent.data1 = read_type<uint8_t>(m_smfFile); // controller
-                midiEvent.data2 = read_type<uint8_t>(m_smfFile); // cont_value
+                midiEvent.data1 = read_type<uint8_t>(m_chunk); // controller
+                midiEvent.data2 = read_type<uint8_t>(m_chunk); // cont_value
                 break;
             case ProgramChange:
-                midiEvent.data1 = read_type<uint8_t>(m_smfFile); // program
+                midiEvent.data1 = read_type<uint8_t>(m_chunk); // program
                 midiEvent.data2 = 0; // no data
                 break;
             case ChannelPressure:
-                midiEvent.data1 = read_type<uint8_t>(m_smfFile); // pressure
+                midiEvent.data1 = read_type<uint8_t>(m_chunk); // pressure
                 midiEvent.data2 = 0; // no data
                 break;
             case PitchBend:
-                midiEvent.data1 = read_type<uint8_t>(m_smfFile); // pitch_low
-                midiEvent.data2 = read_type<uint8_t>(m_smfFile); // pitch_high
+                midiEvent.data1 = read_type<uint8_t>(m_chunk); // pitch_low
+                midiEvent.data2 = read_type<uint8_t>(m_chunk); // pitch_high
                 break;
             default:
                 m_logger->warn("Bad Midi control message {}", static_cast<uint8_t>(midiEvent.message));
@@ -111,14 +111,14 @@ namespace ORCore
 
     void SmfReader::read_meta_event(const SmfEventInfo &eventInfo)
     {
-        MetaEvent event {eventInfo, read_type<MidiMetaEvent>(m_smfFile), read_var_len()};
+        MetaEvent event {eventInfo, read_type<MidiMetaEvent>(m_chunk), read_var_len()};
 
         // In the cases where we dont implement an event type log it, and its data.
         switch(event.type)
         {
             case meta_SequenceNumber:
             {
-                auto sequenceNumber = read_type<uint16_t>(m_smfFile);
+                auto sequenceNumber = read_type<uint16_t>(m_chunk);
                 m_logger->trace(_("Sequence Number {}"), sequenceNumber);
                 break;
             }
@@ -141,7 +141,7 @@ namespace ORCore
             {
                 auto textData = std::make_unique<char[]>(event.length+1);
                 textData[event.length] = '\0';
-                read_type<char>(m_smfFile, textData.get(), event.length);
+                read_type<char>(m_chunk, textData.get(), event.length);
                 m_currentTrack->textEvents.push_back({event, std::string(textData.get())});
                 break;
             }
@@ -150,14 +150,14 @@ namespace ORCore
                 auto textData = std::make_unique<char[]>(event.length+1);
                 textData[event.length] = '\0';
 
-                read_type<char>(m_smfFile, textData.get(), event.length);
+                read_type<char>(m_chunk, textData.get(), event.length);
                 m_currentTrack->name = std::string(textData.get());
                 break;
             }
             case meta_MIDIChannelPrefix:
             {
                 // TODO - Add channel 
-                auto midiChannel = read_type<uint8_t>(m_smfFile);
+                auto midiChannel = read_type<uint8_t>(m_chunk);
                 m_logger->trace(_("Midi Channel {}"), midiChannel);
                 break;
             }
@@ -170,7 +170,7 @@ namespace ORCore
             case meta_Tempo:
             {
                 double absTime = 0.0;
-                uint32_t qnLength = read_type<uint32_t>(m_smfFile, 3);
+                uint32_t qnLength = read_type<uint32_t>(m_chunk, 3);
                 double timePerTick = (qnLength / (m_header.division * 1'000'000.0));
 
                 m_logger->trace("Tempo: qnl: {} PT: {}", qnLength, eventInfo.pulseTime);
@@ -198,12 +198,12 @@ namespace ORCore
             {
                 TimeSignatureEvent tsEvent;
                 tsEvent.info = event;
-                tsEvent.numerator = read_type<uint8_t>(m_smfFile); // 4 default
-                tsEvent.denominator = std::pow(2, read_type<uint8_t>(m_smfFile)); // 4 default
+                tsEvent.numerator = read_type<uint8_t>(m_chunk); // 4 default
+                tsEvent.denominator = std::pow(2, read_type<uint8_t>(m_chunk)); // 4 default
 
                 // This is best described as a bad attempt at supporting meter and is basically useless.
                 // The midi spec examples are also extremely misleading
-                tsEvent.clocksPerBeat = read_type<uint8_t>(m_smfFile); // Standard is 24
+                tsEvent.clocksPerBeat = read_type<uint8_t>(m_chunk); // Standard is 24
 
                 // The number of 1/32nd notes per "MIDI quarter note"
                 // This should be used in order to change the note value which a "MIDI quarter note" is considered.
@@ -218,7 +218,7 @@ namespace ORCore
                 //
                 // Beyond MIDI: The Handbook of Musical Codes page 54 
 
-                tsEvent.thirtySecondPQN = read_type<uint8_t>(m_smfFile); // 8 default
+                tsEvent.thirtySecondPQN = read_type<uint8_t>(m_chunk); // 8 default
 
                 m_logger->debug(_("Time signature  {}/{} CPC: {} TSPQN: {}"),
                                     tsEvent.numerator, tsEvent.denominator,
@@ -247,11 +247,8 @@ namespace ORCore
             {
                 // store data for unused event for later save passthrough.
                 m_logger->debug(_("Unused event type {}."), static_cast<uint8_t>(event.type));
-                std::vector<char> eventData;
-                for (int i=0;i<event.length;++i)
-                {
-                    eventData.emplace_back(read_type<char>(m_smfFile));
-                }
+                const char* data = m_chunk.take(event.length);
+                std::vector<char> eventData(data, data + event.length);
                 m_currentTrack->miscMeta.push_back({event, eventData});
                 break;
             }
@@ -265,8 +262,8 @@ namespace ORCore
         auto length = read_var_len();
         std::vector<char> sysex;
         sysex.resize(length);
-        read_type<char>(m_smfFile, &sysex[0], length);
-        m_logger->trace(_("sysex event at position {}"), m_smfFile.get_pos());
+        read_type<char>(m_chunk, sysex.data(), length);
+        m_logger->trace(_("sysex event at chunk position {}"), m_chunk.get_pos());
     }
 
     // Convert from deltaPulses to deltaTime.
@@ -374,19 +371,19 @@ namespace ORCore
         return &m_header;
     }
 
-    void SmfReader::read_events(uint32_t chunkEnd)
+    void SmfReader::read_events()
     {
         uint32_t pulseTime = 0;
         uint8_t oldRunningStatus = 0;
         bool runningStatusReset = false;
 
         // find a ballpark size estimate for the track 
-        uint32_t sizeGuess = (chunkEnd - m_smfFile.get_pos()) / 3;
+        size_t sizeGuess = m_chunk.remaining() / 3;
         m_currentTrack->midiEvents.reserve(sizeGuess);
 
         SmfEventInfo eventInfo;
 
-        while (m_smfFile.get_pos() < chunkEnd)
+        while (!m_chunk.empty())
         {
 
             eventInfo.deltaPulses = read_var_len();
@@ -398,7 +395,7 @@ namespace ORCore
 
             eventInfo.pulseTime = pulseTime;
 
-            auto status = peek_type<uint8_t>(m_smfFile);
+            auto status = peek_type<uint8_t>(m_chunk);
 
             if (status == status_MetaEvent)
             {
@@ -408,7 +405,7 @@ namespace ORCore
                     oldRunningStatus = eventInfo.status;
                     m_logger->trace("Old Running Status: {}", oldRunningStatus);
                 }
-                eventInfo.status = read_type<uint8_t>(m_smfFile);
+                eventInfo.status = read_type<uint8_t>(m_chunk);
                 read_meta_event(eventInfo);
             }
             else if (status == status_SysexEvent || status == status_SysexEvent2)
@@ -419,7 +416,7 @@ namespace ORCore
                     oldRunningStatus = eventInfo.status;
                     m_logger->trace("Old Running Status: {}", oldRunningStatus);
                 }
-                eventInfo.status = read_type<uint8_t>(m_smfFile);
+                eventInfo.status = read_type<uint8_t>(m_chunk);
                 read_sysex_event(eventInfo);
             }
             else
@@ -427,7 +424,7 @@ namespace ORCore
                 // Check if we should use the running status.
                 if ((status & 0xF0) >= 0x80)
                 {
-                    eventInfo.status = read_type<uint8_t>(m_smfFile);
+                    eventInfo.status = read_type<uint8_t>(m_chunk);
                 }
                 else if (runningStatusReset)
                 {
@@ -444,42 +441,48 @@ namespace ORCore
 
     void SmfReader::read_file()
     {
-        uint32_t fileEnd = m_smfFile.get_size();
-
-        uint32_t fileStart = m_smfFile.get_pos();
-        uint32_t filePos = fileStart;
-        uint32_t fileRemaining = fileEnd;
+        FileSpan file = m_smfFile.get_span();
 
         SmfChunkInfo chunk;
 
-        // set the intial chunk starting position at the beginning of the file.
-        uint32_t chunkStart = fileStart;
-
-        // The chunk end will be calculated after a chunk is loaded.
-        uint32_t chunkEnd = 0;
-
         int trackChunkCount = 0;
 
         // We could loop through the number of track chunks given in the header.
         // However if there are any unknown chunk types inside the midi file
         // this will likely break. So we just loop until we hit the end of the
         // file instead...
-        while (filePos < fileEnd)
+        while (!file.empty())
         {
+            if (file.remaining() <= 8)
+            {
+                m_logger->warn(_("Ignoring remaining bytes, to few left in midi for another track."));
+                // Skip the rest of the file.
+                break;
+            }
+
+            size_t chunkStart = file.get_pos();
+            read_type<char>(file, chunk.chunkType, 4);
+            chunk.length = read_type<uint32_t>(file);
+
+            if (chunk.length > file.remaining())
+            {
+                m_logger->warn(_("Chunk '{}' is longer than the rest of the file, truncating."), chunk.chunkType);
+                chunk.length = static_cast<uint32_t>(file.remaining());
+            }
 
-            read_type<char>(m_smfFile, chunk.chunkType, 4);
-            chunk.length = read_type<uint32_t>(m_smfFile);
-            chunkEnd = chunkStart + (8 + chunk.length); // 8 is the length of the type + length fields
+            // Everything in the chunk is read from its own span, so the chunk
+            // is bounds checked once here rather than on every read.
+            m_chunk = file.sub_span(chunk.length);
 
             m_logger->trace(_("chunk of type {} detected."), chunk.chunkType);
             // MThd chunk is only in the beginning of the file.
-            if (chunkStart == fileStart && strcmp(chunk.chunkType, "MThd") == 0)
+            if (chunkStart == 0 && strcmp(chunk.chunkType, "MThd") == 0)
             {
                 // Load header chunk
                 m_header.info = chunk;
-                m_header.format = read_type<uint16_t>(m_smfFile);
-                m_header.trackNum = read_type<uint16_t>(m_smfFile);
-                m_header.division = read_type<int16_t>(m_smfFile);
+                m_header.format = read_type<uint16_t>(m_chunk);
+                m_header.trackNum = read_type<uint16_t>(m_chunk);
+                m_header.division = read_type<int16_t>(m_chunk);
 
                 // Make sure we reserve enough space for m_tracks just in-case.
                 m_tracks.reserve(sizeof(SmfTrack) * m_header.trackNum);
@@ -503,31 +506,28 @@ namespace ORCore
                 trackChunkCount += 1;
                 m_tracks.emplace_back();
                 m_currentTrack = &m_tracks.back();
-                read_events(chunkEnd);
 
+                // An event running off the end of the chunk can't be read, keep what came before it.
+                try
+                {
+                    read_events();
+                }
+                catch (std::runtime_error &err)
+                {
+                    m_logger->warn(_("Track chunk ends in the middle of an event, ignoring the rest of the track."));
+                }
             }
             else
             {
                 m_logger->warn(_("Non-standard chunk of type {} detected, skipping."), chunk.chunkType);
             }
 
-            filePos = chunkEnd;
-            chunkStart = filePos;
-
-            // Make sure that we are in the correct location in the chunk
-            // If not seek to the correct location and output an error in the log.
-            if (static_cast<int>(m_smfFile.get_pos()) != filePos)
-            {
-                m_logger->warn(_("Offset for chunk '{}' incorrect, seeking to correct location."), chunk.chunkType);
-                m_logger->warn(_("Offset difference. expected: '{}' actual: '{}'"), m_smfFile.get_pos(), filePos);
-                m_smfFile.set_pos(filePos);
-            }
-            fileRemaining = (fileEnd-filePos);
-            if (fileRemaining != 0 && fileRemaining <= 8)
+            // Make sure that we read the whole chunk, the next chunk always
+            // starts at the end of this one so only log an error.
+            if (!m_chunk.empty())
             {
-                m_logger->warn(_("Ignoring remaining bytes, to few left in midi for another track."));
-                // Skip the rest of the file.
-                break;
+                m_logger->warn(_("Offset for chunk '{}' incorrect, skipping to the next chunk."), chunk.chunkType);
+                m_logger->warn(_("Offset difference. expected: '{}' actual: '{}'"), m_chunk.get_size(), m_chunk.get_pos());
             }
         }
 
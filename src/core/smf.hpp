@@ -203,6 +203,9 @@ namespace ORCore
 
     private:
         FileBuffer m_smfFile;
+
+        // The chunk currently being parsed, event reads are checked against its end.
+        FileSpan m_chunk;
         SmfHeaderChunk m_header;
         TempoTrack m_tempoTrack;
         std::vector<SmfTrack> m_tracks;
@@ -217,7 +220,7 @@ namespace ORCore
         void init_tempo_ts();
         TempoEvent* get_last_tempo_via_abs_time(double absTime);
         TempoEvent* get_last_tempo_via_pulses(uint32_t pulseTime);
-        void read_events(uint32_t chunkEnd);
+        void read_events();
         void read_file();
 
         std::shared_ptr<spdlog::logger> m_logger;
@@ -65,6 +65,14 @@ namespace ORCore
         m_reversalSpeed = revSpeed;
     }
 
+    void Timer::set_time(double time)
+    {
+        m_pausedTimeAmount = time;
+        m_currentTime = get_time();
+        m_previousTime = m_currentTime;
+        m_startTime = m_currentTime;
+    }
+
     bool Timer::is_paused()
     {
         return m_paused;
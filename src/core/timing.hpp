@@ -22,6 +22,10 @@ namespace ORCore
         void reset();
         double set_pause(bool pause);
         void set_resume_target(double negTimeTarget, double revSpeed);
+
+        // Jump to a time, used to keep the timer following an external clock.
+        void set_time(double time);
+
         bool is_paused();
         double tick();
         double get_current_time();
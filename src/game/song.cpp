@@ -6,9 +6,15 @@
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <set>
+#include <functional>
+
+#include <fmt/format.h>
+
 #include "song.hpp"
 
 #include "filesystem.hpp"
+#include "core/audio/decoderregistry.hpp"
 
 namespace ORGame
 {
@@ -499,21 +505,257 @@ namespace ORGame
     // Song Class methods
     /////////////////////////////////////
 
+    // Songs that decode to more than this are streamed from disk instead of cached in memory.
+    // The budget is shared between all stems of a song.
+    const size_t songMemoryBudget = 512 * 1024 * 1024;
+
+    // Number of threads decoding stems in the background.
+    const int songDecoderThreads = 2;
+
+    // Output sample size, mirrors audio.backend.bits in the default config.
+    const int audioOutputBits = 16;
+
+    // Songs are trimmed towards the ReplayGain 2 reference level, but never past -1dB true peak.
+    const double songTargetLoudness = -18.0;
+    const double songMaxTruePeak = -1.0;
+
+    static std::string audio_cache_path()
+    {
+        std::string homePath = ORCore::get_home_path();
+        if (homePath.empty())
+        {
+            return "";
+        }
+        return homePath + PATH_SEP + "cache";
+    }
+
+    // Map a stem file name without extension to the track it belongs to.
+    static TrackType stem_track_type(std::string stemName)
+    {
+        if (stemName == "guitar")
+        {
+            return TrackType::Guitar;
+        }
+        else if (stemName == "rhythm" || stemName == "bass")
+        {
+            return TrackType::Bass;
+        }
+        else if (stemName == "drums" || stemName.compare(0, 6, "drums_") == 0)
+        {
+            return TrackType::Drums;
+        }
+        else if (stemName == "keys")
+        {
+            return TrackType::Keys;
+        }
+        else if (stemName == "vocals")
+        {
+            return TrackType::Vocals;
+        }
+        return TrackType::NONE;
+    }
+
+    // Find all stems in a folder that a decoder can read, preview files are only used by the song list.
+    // Files are recognized by their contents so a stem can be in any supported format, if the same stem
+    // exists in several formats only the first one by file name is used.
+    std::vector<ORCore::FileInfo> find_song_stems(std::string path)
+    {
+        auto &registry = ORCore::get_decoder_registry();
+        std::vector<ORCore::FileInfo> stems;
+
+        for (auto &file : ORCore::get_path_contents(path))
+        {
+            if (file.fileType != ORCore::FileType::File ||
+                file.fileName.compare(0, 7, "preview") == 0 ||
+                !registry.can_open(file.filePath))
+            {
+                continue;
+            }
+            stems.push_back(file);
+        }
+
+        std::sort(stems.begin(), stems.end(),
+            [](const ORCore::FileInfo& a, const ORCore::FileInfo& b)
+            {
+                return a.fileName < b.fileName;
+            });
+
+        std::set<std::string> names;
+        stems.erase(std::remove_if(stems.begin(), stems.end(),
+            [&names](const ORCore::FileInfo& file)
+            {
+                return !names.insert(file.fileName.substr(0, file.fileName.rfind('.'))).second;
+            }), stems.end());
+        return stems;
+    }
+
     Song::Song(std::string songpath)
     : m_path(songpath),
     m_midi("notes.mid"),
-    m_songOgg("song.ogg"),
+    m_decoderPool(songDecoderThreads),
+    m_gainTrim(1.0f),
+    m_whammyEffect(false),
+    m_sampleRate(44100),
+    m_frameOffset(0),
+    m_resumeTime(0.0),
+    m_pauseTime(0.0),
+    m_audioPaused(false),
+    m_pauseFrame(0),
     m_logger(spdlog::get("default"))
     {
         logger = spdlog::get("default");
 
-        m_audioOut.set_source(&m_songOgg);
+        open_stems();
+
+        m_spectrum.add_source(&m_buses);
+        m_audioOut.set_source(&m_spectrum);
+        m_audioOut.set_sample_bits(audioOutputBits);
         m_tempoTrack.set_midi(&m_midi);
     }
 
     Song::~Song()
     {
         m_audioOut.stop();
+        m_spectrum.stop();
+    }
+
+    void Song::open_stems()
+    {
+        auto stemFiles = find_song_stems(m_path);
+        if (stemFiles.empty())
+        {
+            // Fall back to the working directory like the midi file does.
+            stemFiles = find_song_stems(".");
+        }
+        if (stemFiles.empty())
+        {
+            throw std::runtime_error("No song audio found.");
+        }
+
+        size_t stemBudget = songMemoryBudget / stemFiles.size();
+        std::string cachePath = audio_cache_path();
+
+        load_loudness(stemFiles, cachePath);
+
+        // Mix at the devices native rate, stems recorded at another rate get resampled by the mixer.
+        m_buses.set_format(m_audioOut.get_preferred_format());
+        m_buses.set_command_queue(&m_commands);
+        m_buses.add_bus("track");
+        m_buses.add_bus("background");
+        m_buses.add_bus("crowd");
+        m_buses.add_bus("effects");
+        set_volumes(m_volumes);
+
+        m_stems.reserve(stemFiles.size());
+        for (auto &file : stemFiles)
+        {
+            SongStem stem;
+            stem.name = file.fileName.substr(0, file.fileName.rfind('.'));
+            stem.type = stem_track_type(stem.name);
+
+            if (stem.type != TrackType::NONE)
+            {
+                stem.bus = "track";
+            }
+            else if (stem.name == "crowd")
+            {
+                stem.bus = "crowd";
+            }
+            else
+            {
+                stem.bus = "background";
+            }
+
+            stem.source = std::make_unique<ORCore::PcmCacheSource>(file.filePath, stemBudget, cachePath, &m_decoderPool);
+            stem.stream = std::make_unique<ORCore::DecodeAhead>(stem.source.get(), 16384, 1024, &m_decoderPool);
+            stem.output = stem.stream.get();
+
+            // The whammy stage passes the stem through untouched until it is used.
+            if (stem.type == TrackType::Guitar)
+            {
+                stem.whammy = std::make_unique<ORCore::PitchShift>(m_buses.get_format().channels);
+                stem.whammy->add_source(stem.stream.get());
+                stem.output = stem.whammy.get();
+            }
+
+            m_buses.get_bus(stem.bus)->add_source(stem.output);
+
+            logger->debug(_("Opened song stem {}"), file.filePath);
+            m_stems.push_back(std::move(stem));
+        }
+
+        // Created at the mixers rate so effects never need resampling while playing.
+        m_effects = std::make_unique<ORCore::SamplerSource>(m_buses.get_format());
+        m_buses.get_bus("effects")->add_source(m_effects.get());
+
+        m_click = std::make_unique<ORCore::ClickSource>(m_buses.get_format());
+        m_click->set_enabled(false);
+        m_buses.get_bus("effects")->add_source(m_click.get());
+
+        m_sampleRate = m_buses.get_format().sampleRate;
+    }
+
+    // Apply the gain trim from a previous loudness analysis of the stems. Without one the stems are analyzed
+    // in the background and the trim is applied the next time the song is loaded, so playback never waits on it.
+    void Song::load_loudness(const std::vector<ORCore::FileInfo>& stemFiles, std::string cachePath)
+    {
+        if (cachePath.empty())
+        {
+            return;
+        }
+
+        std::vector<std::string> filenames;
+        for (auto &file : stemFiles)
+        {
+            filenames.push_back(file.filePath);
+        }
+        std::string cacheFilename = fmt::format("{}{}{:016x}.loudness", cachePath, PATH_SEP,
+                                                std::hash<std::string>()(m_path));
+
+        ORCore::LoudnessInfo loudness;
+        if (ORCore::LoudnessJob::load_cache(cacheFilename, filenames, loudness))
+        {
+            m_gainTrim = ORCore::loudness_gain(loudness, songTargetLoudness, songMaxTruePeak);
+            logger->debug(_("Song loudness {:.1f} LUFS, {:.1f} dBTP, gain trim {:.2f}"),
+                          loudness.integrated, loudness.truePeak, m_gainTrim);
+            return;
+        }
+
+        try
+        {
+            m_loudnessJob = std::make_unique<ORCore::LoudnessJob>(filenames, cacheFilename, &m_decoderPool);
+        }
+        catch (std::runtime_error &err)
+        {
+            logger->warn(_("Loudness analysis failed: {}"), err.what());
+        }
+    }
+
+    // The click schedule is built once here, before the audio output starts pulling it.
+    void Song::load_clicks()
+    {
+        int measure = m_click->add_tone(1760.0f);
+        int beat = m_click->add_tone(880.0f);
+        int upbeat = m_click->add_tone(880.0f, 0.03, 0.5f);
+
+        std::vector<ORCore::Click> clicks;
+        clicks.reserve(m_tempoTrack.get_bars().size());
+        for (auto &bar : m_tempoTrack.get_bars())
+        {
+            switch (bar.type)
+            {
+                case BarType::measure:
+                    clicks.push_back({bar.time, measure});
+                    break;
+                case BarType::beat:
+                    clicks.push_back({bar.time, beat});
+                    break;
+                case BarType::upbeat:
+                    clicks.push_back({bar.time, upbeat});
+                    break;
+            }
+        }
+        m_click->set_clicks(clicks);
     }
 
     void Song::add(TrackType type, Difficulty difficulty, bool hopoSupport)
@@ -576,6 +818,7 @@ namespace ORGame
 
         m_tempoTrack.add_tempo_event(lastQnLength, m_midi.pulsetime_to_abstime(m_length), m_length); // add final tempo change for bar barking purposes.
         m_tempoTrack.mark_bars();
+        load_clicks();
 
         if (!foundUsable)
         {
@@ -699,7 +942,18 @@ namespace ORGame
 
     void Song::start()
     {
+        // Give the decoders a head start so playback never catches up to them.
+        for (auto &stem : m_stems)
+        {
+            stem.source->wait_decoded(5.0);
+        }
         m_songTimer.reset();
+        for (auto &stem : m_stems)
+        {
+            stem.stream->start();
+        }
+        m_frameOffset = m_buses.get_frame_position();
+        m_spectrum.start();
         m_audioOut.start();
         m_logger->info("Song started");
     }
@@ -709,10 +963,47 @@ namespace ORGame
         // TODO - there is likely a better place for this...
         // Basically the plan here is have an update method.
         double tick = m_songTimer.tick();
+
+        if (!m_audioPaused)
+        {
+            // While audio is playing the output's sample clock is the authority, the timer just follows it
+            // so pausing starts from the right place.
+            m_audioOut.update_latency();
+            double played = m_audioOut.get_clock().get_frames_played();
+            double time = (played - m_frameOffset) / m_sampleRate;
+
+            // Right after resuming the first new frames are still in flight, hold instead of jumping back.
+            time = std::max(time, m_resumeTime);
+            m_songTimer.set_time(time);
+            return time;
+        }
+
         double time = m_songTimer.get_current_time();
         if (time < m_pauseTime && tick > 0.0)
         {
-            m_songOgg.set_pause(false);
+            // All stems resume together, so wait until the pause commands were applied
+            // and every stem has finished seeking.
+            int64_t frame = m_buses.get_frame_position();
+            bool ready = frame > m_pauseFrame && std::all_of(m_stems.begin(), m_stems.end(),
+                [](SongStem& stem)
+                {
+                    return stem.stream->is_ready();
+                });
+
+            if (ready)
+            {
+                m_resumeTime = std::max(m_pauseTime - 1.5, 0.0);
+                m_frameOffset = frame - std::llround(m_resumeTime * m_sampleRate);
+                m_songTimer.set_time(m_resumeTime);
+
+                // The mixer is already past frame, so these apply at the start of its next block.
+                for (auto &stem : m_stems)
+                {
+                    m_commands.push({ORCore::CommandType::resume, frame, stem.stream.get(), nullptr, 0.0});
+                }
+                m_commands.push({ORCore::CommandType::resume, frame, m_click.get(), nullptr, 0.0});
+                m_audioPaused = false;
+            }
         }
         return time;
     }
@@ -768,7 +1059,7 @@ namespace ORGame
 
     double Song::get_audio_time()
     {
-        return m_songOgg.get_time();
+        return m_stems.front().stream->get_time();
     }
 
     void Song::set_pause(bool pause)
@@ -779,10 +1070,127 @@ namespace ORGame
             m_pauseTime = time;
         }
         m_songTimer.set_resume_target(m_pauseTime-1.5, 2.0);
-        if (pause)
+        if (pause && !m_audioPaused)
+        {
+            // Stop everything on the same frame and rewind, the stems decode ahead from there while paused.
+            double seekTime = std::max(m_pauseTime - 1.5, 0.0);
+            m_pauseFrame = m_buses.get_frame_position();
+            for (auto &stem : m_stems)
+            {
+                m_commands.push({ORCore::CommandType::pause, m_pauseFrame, stem.stream.get(), nullptr, 0.0});
+                m_commands.push({ORCore::CommandType::seek, m_pauseFrame, stem.stream.get(), nullptr, seekTime});
+            }
+
+            // The click is pulled with the stems so it resumes from the same time they do.
+            m_commands.push({ORCore::CommandType::pause, m_pauseFrame, m_click.get(), nullptr, 0.0});
+            m_commands.push({ORCore::CommandType::seek, m_pauseFrame, m_click.get(), nullptr, seekTime});
+            m_audioPaused = true;
+        }
+    }
+
+    void Song::miss_note(TrackType type, double time)
+    {
+        set_stem_gain(type, time, m_volumes.miss);
+    }
+
+    void Song::screw_up(TrackType type, double time)
+    {
+        set_stem_gain(type, time, m_volumes.screwUp);
+    }
+
+    void Song::hit_note(TrackType type, double time)
+    {
+        set_stem_gain(type, time, 1.0f);
+    }
+
+    int Song::load_effect(std::string filename)
+    {
+        int effect = m_effects->load_sample(filename);
+        if (effect < 0)
+        {
+            logger->error(_("Failed to load sound effect {}"), filename);
+        }
+        return effect;
+    }
+
+    void Song::play_effect(int effect, double time, float gain)
+    {
+        // The sampler is pulled with the stems so its frame count matches the mixers.
+        int64_t frame = std::llround(time * m_sampleRate) + m_frameOffset;
+        if (!m_effects->trigger(effect, frame, gain))
+        {
+            logger->warn(_("Dropped sound effect {}"), effect);
+        }
+    }
+
+    void Song::set_volumes(AudioVolumes volumes)
+    {
+        m_volumes = volumes;
+
+        // Effects are not part of the song so they are left untrimmed.
+        m_buses.set_bus_gain("track", m_volumes.track * m_gainTrim);
+        m_buses.set_bus_gain("background", m_volumes.background * m_gainTrim);
+        m_buses.set_bus_gain("crowd", m_volumes.crowd * m_gainTrim);
+        m_buses.set_bus_gain("effects", m_volumes.effects);
+    }
+
+    void Song::set_whammy_effect(bool enabled)
+    {
+        m_whammyEffect = enabled;
+        if (!enabled)
         {
-            m_songOgg.set_pause(true);
-            m_songOgg.seek(m_pauseTime-1.5);
+            for (auto &stem : m_stems)
+            {
+                if (stem.whammy)
+                {
+                    stem.whammy->set_whammy(0.0f);
+                }
+            }
+        }
+    }
+
+    void Song::set_whammy(TrackType type, float amount)
+    {
+        if (!m_whammyEffect)
+        {
+            return;
+        }
+
+        for (auto &stem : m_stems)
+        {
+            if (stem.type == type && stem.whammy)
+            {
+                stem.whammy->set_whammy(amount);
+            }
+        }
+    }
+
+    void Song::set_click(bool enabled)
+    {
+        m_click->set_enabled(enabled);
+    }
+
+    void Song::set_click_offset(double offset)
+    {
+        m_click->set_offset(offset);
+    }
+
+    bool Song::read_spectrum(ORCore::SpectrumFrame& frame)
+    {
+        return m_spectrum.read(frame);
+    }
+
+    void Song::set_stem_gain(TrackType type, double time, float gain)
+    {
+        // Every bus is pulled with the master so the track bus counts the same frames.
+        int64_t frame = std::llround(time * m_sampleRate) + m_frameOffset;
+        ORCore::Mixer* trackBus = m_buses.get_bus("track");
+        for (auto &stem : m_stems)
+        {
+            if (stem.type == type)
+            {
+                m_commands.push({ORCore::CommandType::gain, frame, trackBus, stem.output, gain});
+            }
         }
     }
 
@@ -5,13 +5,24 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <spdlog/spdlog.h>
 
 #include "smf.hpp"
 #include "timing.hpp"
-
-#include "core/audio/vorbissource.hpp"
+#include "filesystem.hpp"
+
+#include "core/audio/pcmcachesource.hpp"
+#include "core/audio/decodeahead.hpp"
+#include "core/audio/decoderpool.hpp"
+#include "core/audio/mixer.hpp"
+#include "core/audio/busgraph.hpp"
+#include "core/audio/samplersource.hpp"
+#include "core/audio/pitchshift.hpp"
+#include "core/audio/clicksource.hpp"
+#include "core/audio/spectrumtap.hpp"
 #include "core/audio/cubeboutput.hpp"
+#include "core/audio/loudness.hpp"
 
 namespace ORGame
 {
@@ -158,6 +169,34 @@ namespace ORGame
         std::vector<Event> m_events;
     };
 
+    // Linear gains mirroring audio.volumes in the default config.
+    // screwUp and miss are relative to the track bus, the rest are bus gains.
+    struct AudioVolumes
+    {
+        float track = 1.0f;
+        float background = 0.8f;
+        float screwUp = 0.4f;
+        float miss = 0.2f;
+        float crowd = 0.8f;
+        float effects = 0.7f;
+        float menu = 0.6f;
+    };
+
+    // One audio file of a song such as guitar.ogg or drums_1.ogg.
+    // Stems without an instrument (song.ogg, crowd.ogg) have a type of NONE.
+    struct SongStem
+    {
+        std::string name;
+        TrackType type;
+        std::string bus;
+        std::unique_ptr<ORCore::PcmCacheSource> source;
+        std::unique_ptr<ORCore::DecodeAhead> stream;
+
+        // Only guitar stems have a whammy stage, output is whatever is mixed into the bus.
+        std::unique_ptr<ORCore::PitchShift> whammy;
+        ORCore::Stream* output;
+    };
+
     class Song
     {
     public:
@@ -190,7 +229,41 @@ namespace ORGame
         double get_audio_time();
         void set_pause(bool pause);
 
+        // Attenuate or restore the stems of a track starting at the exact sample for the given song time.
+        void miss_note(TrackType type, double time);
+        void screw_up(TrackType type, double time);
+        void hit_note(TrackType type, double time);
+
+        // One-shot sound effects played through the song mixer at the effects volume.
+        // Load effects before starting the song, playing them is lock-free and can be done every frame.
+        int load_effect(std::string filename);
+        void play_effect(int effect, double time, float gain = 1.0f);
+
+        // Apply new volume settings, takes effect smoothly while playing.
+        void set_volumes(AudioVolumes volumes);
+
+        // Mirrors game.whammy_effect in the default config, off by default.
+        void set_whammy_effect(bool enabled);
+
+        // Bend the guitar stems of a track from a controller axis, 0.0 at rest to 1.0 fully pressed.
+        // Lock-free so it can be called with every controller event.
+        void set_whammy(TrackType type, float amount);
+
+        // Metronome on the beats of the tempo track for practice mode, off by default.
+        // The offset in seconds delays the clicks to calibrate them against the output latency.
+        void set_click(bool enabled);
+        void set_click_offset(double offset);
+
+        // Newest spectrum of the song mix for visuals, returns false if there is nothing new since the last call.
+        // Never blocks so it can be called every rendered frame.
+        bool read_spectrum(ORCore::SpectrumFrame& frame);
+
     private:
+        void open_stems();
+        void load_loudness(const std::vector<ORCore::FileInfo>& stemFiles, std::string cachePath);
+        void load_clicks();
+        void set_stem_gain(TrackType type, double time, float gain);
+
         ORCore::SmfReader m_midi;
         std::vector<TrackInfo> m_tracksInfo;
         std::vector<Track> m_tracks;
@@ -198,9 +271,31 @@ namespace ORGame
         std::string m_path;
         uint32_t m_length;
         ORCore::Timer m_songTimer;
-        ORCore::VorbisSource m_songOgg;
+        AudioVolumes m_volumes;
+
+        // The pool must outlive the stems that are decoded on it.
+        ORCore::DecoderPool m_decoderPool;
+        std::unique_ptr<ORCore::LoudnessJob> m_loudnessJob;
+        std::vector<SongStem> m_stems;
+        ORCore::CommandQueue m_commands;
+        ORCore::BusGraph m_buses;
+        ORCore::SpectrumTap m_spectrum;
+        std::unique_ptr<ORCore::SamplerSource> m_effects;
+        std::unique_ptr<ORCore::ClickSource> m_click;
         ORCore::CubebOutput m_audioOut;
+        float m_gainTrim;
+        bool m_whammyEffect;
+        int m_sampleRate;
+
+        // Mixer frame position of song time 0, changes every time playback is resumed after a seek.
+        int64_t m_frameOffset;
+        double m_resumeTime;
         double m_pauseTime;
+
+        // The mixers keep running while the song is paused, only the stems and click are paused
+        // through the command queue so pausing and resuming land on an exact frame.
+        bool m_audioPaused;
+        int64_t m_pauseFrame;
         std::shared_ptr<spdlog::logger> m_logger;
 
     };
@@ -209,4 +304,7 @@ namespace ORGame
     const std::string diff_type_to_name(Difficulty diff);
     const TrackType get_track_type(std::string trackName);
     const std::string track_name_to_type(TrackType type);
+
+    // Audio files of the song in path that a decoder can read, sorted by name.
+    std::vector<ORCore::FileInfo> find_song_stems(std::string path);
 } // namespace ORGame
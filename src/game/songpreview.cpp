@@ -0,0 +1,309 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#include "config.hpp"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+#include "songpreview.hpp"
+#include "filesystem.hpp"
+#include "stringutils.hpp"
+#include "core/audio/decoderregistry.hpp"
+
+namespace ORGame
+{
+    const double previewLength = 30.0;
+    const double previewFade = 0.5;
+
+    // Where previews start in songs that don't set preview_start_time.
+    const double previewDefaultStart = 0.3;
+
+    // How often finished previews are checked for while they fade out.
+    const std::chrono::milliseconds previewReapInterval(20);
+
+    static std::string to_lower(std::string str)
+    {
+        std::transform(str.begin(), str.end(), str.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return str;
+    }
+
+    static std::string trim(const std::string& str)
+    {
+        size_t start = str.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = str.find_last_not_of(" \t\r\n");
+        return str.substr(start, end - start + 1);
+    }
+
+    // preview_start_time from song.ini in seconds, or -1 if the song doesn't have one.
+    static double read_preview_start(std::string songPath)
+    {
+        std::string contents;
+        try
+        {
+            contents = ORCore::read_file(songPath + PATH_SEP + "song.ini");
+        }
+        catch (std::runtime_error &err)
+        {
+            return -1.0;
+        }
+
+        for (auto &line : ORCore::stringSplit(contents, "\n"))
+        {
+            size_t equals = line.find('=');
+            if (equals == std::string::npos || to_lower(trim(line.substr(0, equals))) != "preview_start_time")
+            {
+                continue;
+            }
+
+            try
+            {
+                return std::stod(trim(line.substr(equals + 1))) / 1000.0;
+            }
+            catch (std::logic_error &err)
+            {
+                return -1.0;
+            }
+        }
+        return -1.0;
+    }
+
+    // A dedicated preview file is used as is, otherwise the preview is a mix of all stems.
+    static std::vector<std::string> find_preview_files(std::string songPath, bool& isPreviewFile)
+    {
+        auto &registry = ORCore::get_decoder_registry();
+        for (auto &file : ORCore::get_path_contents(songPath))
+        {
+            if (file.fileType == ORCore::FileType::File && file.fileName.compare(0, 7, "preview") == 0 &&
+                registry.can_open(file.filePath))
+            {
+                isPreviewFile = true;
+                return {file.filePath};
+            }
+        }
+
+        isPreviewFile = false;
+        std::vector<std::string> filenames;
+        for (auto &file : find_song_stems(songPath))
+        {
+            filenames.push_back(file.filePath);
+        }
+        return filenames;
+    }
+
+    SongPreview::SongPreview(PreviewSettings settings, AudioVolumes volumes)
+    : m_settings(settings),
+    m_logger(spdlog::get("default")),
+    m_requestId(0),
+    m_running(false),
+    m_startLatency(0.0)
+    {
+        m_buses.set_format(m_audioOut.get_preferred_format());
+        m_buses.add_bus("menu");
+        set_volumes(volumes);
+        m_audioOut.set_source(&m_buses);
+    }
+
+    SongPreview::~SongPreview()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_requested.notify_one();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        m_audioOut.stop();
+    }
+
+    bool SongPreview::start()
+    {
+        if (!m_settings.audioPreview)
+        {
+            return true;
+        }
+
+        if (!m_audioOut.start())
+        {
+            return false;
+        }
+
+        m_running = true;
+        m_thread = std::thread(&SongPreview::worker, this);
+        return true;
+    }
+
+    void SongPreview::request(std::string songPath)
+    {
+        if (!m_settings.audioPreview)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_requestPath = songPath;
+            m_requestTime = std::chrono::steady_clock::now();
+            m_requestId++;
+        }
+        m_requested.notify_one();
+    }
+
+    void SongPreview::set_volumes(AudioVolumes volumes)
+    {
+        m_buses.set_bus_gain("menu", volumes.menu);
+    }
+
+    double SongPreview::get_start_latency()
+    {
+        return m_startLatency.load(std::memory_order_acquire);
+    }
+
+    void SongPreview::worker()
+    {
+        auto delay = std::chrono::milliseconds(m_settings.previewDelay);
+        uint64_t handledId = 0;
+        bool decoding = false;
+
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto pending = [&]() { return !m_running || m_requestId != handledId; };
+
+            // Only sleep when there is nothing left to decode, polling while previews fade so they are removed.
+            if (!decoding)
+            {
+                if (m_fading.empty() && m_current == nullptr)
+                {
+                    m_requested.wait(lock, pending);
+                }
+                else
+                {
+                    m_requested.wait_for(lock, previewReapInterval, pending);
+                }
+            }
+            if (!m_running)
+            {
+                break;
+            }
+
+            // Requests are only accepted once they have been the latest for the preview delay,
+            // anything replaced before then is dropped without opening a file.
+            std::string path;
+            bool accepted = false;
+            auto now = std::chrono::steady_clock::now();
+            if (m_requestId != handledId)
+            {
+                uint64_t requestId = m_requestId;
+                if (now >= m_requestTime + delay)
+                {
+                    path = m_requestPath;
+                    handledId = requestId;
+                    accepted = true;
+                }
+                else if (!decoding)
+                {
+                    m_requested.wait_until(lock, m_requestTime + delay,
+                        [&]() { return !m_running || m_requestId != requestId; });
+                    continue;
+                }
+            }
+            lock.unlock();
+
+            if (accepted)
+            {
+                play(path, now);
+                decoding = m_current != nullptr;
+            }
+            else if (decoding)
+            {
+                decoding = m_current->decode_step();
+            }
+            reap_finished();
+
+            // A preview that finished playing is reaped even if it wasn't done decoding.
+            if (m_current == nullptr)
+            {
+                decoding = false;
+            }
+        }
+    }
+
+    void SongPreview::play(std::string songPath, std::chrono::steady_clock::time_point acceptTime)
+    {
+        // The old preview is no longer decoded, it fades out with whatever it has.
+        if (m_current != nullptr)
+        {
+            m_current->fade_out();
+            m_fading.push_back(std::move(m_current));
+        }
+
+        if (songPath.empty())
+        {
+            return;
+        }
+
+        try
+        {
+            bool isPreviewFile = false;
+            auto filenames = find_preview_files(songPath, isPreviewFile);
+            if (filenames.empty())
+            {
+                m_logger->debug(_("No preview audio in {}"), songPath);
+                return;
+            }
+
+            auto segment = std::make_unique<ORCore::SegmentSource>(filenames, 0.0, previewLength, previewFade);
+            if (!isPreviewFile)
+            {
+                double length = segment->get_file_length();
+                double start = read_preview_start(songPath);
+                if (start < 0.0 || start >= length)
+                {
+                    start = length * previewDefaultStart;
+                }
+                segment->set_start(start);
+            }
+
+            // Playback only waits for the first chunk, the rest is decoded while it plays.
+            segment->decode_step();
+            m_buses.get_bus("menu")->add_source(segment.get());
+            m_current = std::move(segment);
+
+            std::chrono::duration<double> latency = std::chrono::steady_clock::now() - acceptTime;
+            m_startLatency.store(latency.count(), std::memory_order_release);
+            m_logger->debug(_("Preview of {} started in {:.1f}ms"), songPath, latency.count() * 1000.0);
+        }
+        catch (std::runtime_error &err)
+        {
+            m_logger->warn(_("Failed to preview {}: {}"), songPath, err.what());
+        }
+    }
+
+    void SongPreview::reap_finished()
+    {
+        auto menu = m_buses.get_bus("menu");
+        auto finished = [menu](std::unique_ptr<ORCore::SegmentSource>& segment)
+        {
+            if (!segment->is_paused())
+            {
+                return false;
+            }
+            menu->remove_source(segment.get());
+            return true;
+        };
+
+        m_fading.erase(std::remove_if(m_fading.begin(), m_fading.end(), finished), m_fading.end());
+        if (m_current != nullptr && finished(m_current))
+        {
+            m_current.reset();
+        }
+    }
+}
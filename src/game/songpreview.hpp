@@ -0,0 +1,77 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <spdlog/spdlog.h>
+
+#include "song.hpp"
+#include "core/audio/busgraph.hpp"
+#include "core/audio/segmentsource.hpp"
+#include "core/audio/cubeboutput.hpp"
+
+namespace ORGame
+{
+    // Mirrors the menus section of the default config.
+    struct PreviewSettings
+    {
+        bool audioPreview = true;
+        int previewDelay = 100; // ms
+    };
+
+    // Plays song previews for the song browser.
+    // Requests are cheap and can be made for every song scrolled past, only the latest one is kept.
+    // Once a request has been the latest for the preview delay a worker opens the song, seeks to the preview start
+    // and decodes just the preview segment, starting playback after the first chunk.
+    // The new preview crossfades with the previous one on the menu bus.
+    class SongPreview
+    {
+    public:
+        SongPreview(PreviewSettings settings = PreviewSettings(), AudioVolumes volumes = AudioVolumes());
+        ~SongPreview();
+
+        // Open the audio device and start the worker.
+        bool start();
+
+        // Preview the song in songPath, an empty path fades out the current preview.
+        void request(std::string songPath);
+
+        void set_volumes(AudioVolumes volumes);
+
+        // Time from a request being accepted to its audio being mixed in, for the last preview started.
+        double get_start_latency();
+
+    private:
+        void worker();
+        void play(std::string songPath, std::chrono::steady_clock::time_point acceptTime);
+        void reap_finished();
+
+        PreviewSettings m_settings;
+        std::shared_ptr<spdlog::logger> m_logger;
+
+        ORCore::BusGraph m_buses;
+        ORCore::CubebOutput m_audioOut;
+
+        // Only used by the worker. The current preview is still being decoded, fading ones wait to be removed.
+        std::unique_ptr<ORCore::SegmentSource> m_current;
+        std::vector<std::unique_ptr<ORCore::SegmentSource>> m_fading;
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_requested;
+        std::string m_requestPath;
+        uint64_t m_requestId;
+        std::chrono::steady_clock::time_point m_requestTime;
+        bool m_running;
+
+        std::atomic<double> m_startLatency;
+    };
+}
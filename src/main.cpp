@@ -11,6 +11,7 @@
 #include <spdlog/spdlog.h>
 
 #include "game.hpp"
+#include "core/audio/rtlog.hpp"
 
 // Eventually we will want to load configuration files somewhere in here.
 int main(int argc, char** argv)
@@ -108,6 +109,8 @@ int main(int argc, char** argv)
 
     try
     {
+        // Carries log messages from the audio thread to the logger.
+        ORCore::RtLogDrain audioLog;
         ORGame::GameManager game;
         game.start();
     }
@@ -0,0 +1,475 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+// Audio pipeline benchmarks.
+// Builds synthetic graphs of N sine producers -> Mixer -> optional TimeStretch and reports:
+//  - Per stage cost in nanoseconds per frame.
+//  - Histograms of simulated callback time as a fraction of the callback deadline for several block sizes.
+//
+//  - Cost of the one-shot sampler with hundreds of overlapping voices as a percentage of one core.
+//  - Cost of a whammy pitch bend on the guitar stem of every player, checked against a fixed budget.
+//    Mono guitar stems are benched as well since they are mapped to the mixers layout on the way in.
+//  - Cost of each vocal pitch detection hop, checked against a fixed budget.
+//
+// Usage: audiobench [sources] [stretch 0/1] [max p99 load percent]
+// When a max load is given the exit code is non zero if any block size goes over it,
+// which allows this to be used to catch regressions in callback cost.
+
+#include "config.hpp"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include <fmt/format.h>
+
+#include "core/audio/streams.hpp"
+#include "core/audio/mixer.hpp"
+#include "core/audio/timestretch.hpp"
+#include "core/audio/aligned.hpp"
+#include "core/audio/samplersource.hpp"
+#include "core/audio/pitchshift.hpp"
+#include "core/audio/pitchdetector.hpp"
+
+#include "teststreams.hpp"
+
+using BenchClock = std::chrono::steady_clock;
+
+const int benchSampleRate = 44100;
+const int benchChannels = 2;
+
+// Share of each callback deadline that whammy on every players guitar stem may use together.
+const int whammyPlayers = 8;
+const double whammyBudget = 5.0;
+
+// Milliseconds of analysis each 10ms pitch detection hop may take.
+const double pitchHopBudget = 1.0;
+
+// Pass through stage that records how long its source took to pull.
+class TimedStream: public ORCore::InputStream
+{
+public:
+    bool add_source(ORCore::Stream* stream)
+    {
+        m_stream = stream;
+        return true;
+    }
+
+    void pull(ORCore::Buffer& buffer)
+    {
+        auto start = BenchClock::now();
+        m_stream->pull(buffer);
+        auto end = BenchClock::now();
+
+        m_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        m_frames += buffer.get_info().frames;
+    }
+
+    ORCore::StreamFormat get_format()
+    {
+        return m_stream->get_format();
+    }
+
+    bool is_paused()
+    {
+        return m_stream->is_paused();
+    }
+
+    void reset()
+    {
+        m_nanoseconds = 0;
+        m_frames = 0;
+    }
+
+    int64_t get_nanoseconds()
+    {
+        return m_nanoseconds;
+    }
+
+    int64_t get_frames()
+    {
+        return m_frames;
+    }
+
+private:
+    ORCore::Stream* m_stream = nullptr;
+    int64_t m_nanoseconds = 0;
+    int64_t m_frames = 0;
+};
+
+struct BenchGraph
+{
+    std::vector<std::unique_ptr<SineStream>> sines;
+    std::vector<std::unique_ptr<TimedStream>> timedSines;
+    ORCore::Mixer mixer;
+    TimedStream timedMixer;
+    ORCore::TimeStretch stretch;
+    TimedStream timedStretch;
+    ORCore::Stream* output;
+
+    void reset()
+    {
+        for (auto &timed : timedSines)
+        {
+            timed->reset();
+        }
+        timedMixer.reset();
+        timedStretch.reset();
+    }
+};
+
+std::unique_ptr<BenchGraph> build_graph(int sources, bool useStretch, int maxFrames)
+{
+    auto graph = std::make_unique<BenchGraph>();
+
+    for (int i = 0; i < sources; ++i)
+    {
+        graph->sines.push_back(std::make_unique<SineStream>(220 + (i * 55), benchSampleRate));
+        graph->timedSines.push_back(std::make_unique<TimedStream>());
+        graph->timedSines.back()->add_source(graph->sines.back().get());
+        graph->mixer.add_source(graph->timedSines.back().get());
+    }
+    graph->mixer.start(maxFrames);
+    graph->timedMixer.add_source(&graph->mixer);
+    graph->output = &graph->timedMixer;
+
+    if (useStretch)
+    {
+        graph->stretch.add_source(&graph->timedMixer);
+        graph->stretch.set_speed(0.75f);
+        graph->timedStretch.add_source(&graph->stretch);
+        graph->output = &graph->timedStretch;
+    }
+    return graph;
+}
+
+void bench_stages(int sources, bool useStretch)
+{
+    const int blockFrames = 512;
+    const int seconds = 30;
+
+    auto graph = build_graph(sources, useStretch, blockFrames);
+    auto data = ORCore::make_aligned_floats(blockFrames * benchChannels);
+    ORCore::Buffer buffer(data.get(), {benchChannels, blockFrames});
+
+    int callbacks = (seconds * benchSampleRate) / blockFrames;
+    for (int i = 0; i < callbacks; ++i)
+    {
+        graph->output->pull(buffer);
+    }
+
+    int64_t sourceNs = 0;
+    int64_t sourceFrames = 0;
+    for (auto &timed : graph->timedSines)
+    {
+        sourceNs += timed->get_nanoseconds();
+        sourceFrames += timed->get_frames();
+    }
+
+    int64_t mixerNs = graph->timedMixer.get_nanoseconds() - sourceNs;
+    double mixerFrames = static_cast<double>(graph->timedMixer.get_frames());
+
+    fmt::print("Stage cost, {} sources, {} frame blocks, {} seconds of audio\n", sources, blockFrames, seconds);
+    fmt::print("  {:<12} {:>10.2f} ns/frame per source\n", "sources", sourceNs / static_cast<double>(sourceFrames));
+    fmt::print("  {:<12} {:>10.2f} ns/frame ({:.2f} per source)\n", "mixer",
+        mixerNs / mixerFrames, mixerNs / mixerFrames / sources);
+
+    if (useStretch)
+    {
+        int64_t stretchNs = graph->timedStretch.get_nanoseconds() - graph->timedMixer.get_nanoseconds();
+        fmt::print("  {:<12} {:>10.2f} ns/frame\n", "timestretch",
+            stretchNs / static_cast<double>(graph->timedStretch.get_frames()));
+    }
+    fmt::print("\n");
+}
+
+// Returns the 99th percentile callback load in percent of the deadline for the worst block size.
+double bench_callbacks(int sources, bool useStretch)
+{
+    const std::vector<int> blockSizes = {64, 128, 256, 512, 1024, 2048, 4096};
+
+    // Bucket upper bounds as a percentage of the callback deadline.
+    const std::vector<double> bucketEdges = {1.0, 2.0, 5.0, 10.0, 25.0, 50.0, 75.0, 100.0};
+
+    const int seconds = 20;
+    double worstP99 = 0.0;
+
+    fmt::print("Callback time as a percentage of the deadline, {} sources\n", sources);
+    fmt::print("  {:>6} {:>9} {:>8} {:>8} {:>8} {:>8} |", "frames", "deadline", "mean", "p50", "p99", "max");
+    for (auto edge : bucketEdges)
+    {
+        fmt::print(" <{:<5}", edge);
+    }
+    fmt::print(" >100\n");
+
+    for (int blockFrames : blockSizes)
+    {
+        auto graph = build_graph(sources, useStretch, blockFrames);
+        auto data = ORCore::make_aligned_floats(blockFrames * benchChannels);
+        ORCore::Buffer buffer(data.get(), {benchChannels, blockFrames});
+
+        double deadlineNs = (blockFrames * 1e9) / benchSampleRate;
+        int callbacks = std::max(200, (seconds * benchSampleRate) / blockFrames);
+
+        // Warm up caches and let the stretcher fill.
+        for (int i = 0; i < 32; ++i)
+        {
+            graph->output->pull(buffer);
+        }
+
+        std::vector<double> loads;
+        loads.reserve(callbacks);
+        std::vector<int> buckets(bucketEdges.size() + 1, 0);
+
+        for (int i = 0; i < callbacks; ++i)
+        {
+            auto start = BenchClock::now();
+            graph->output->pull(buffer);
+            auto end = BenchClock::now();
+
+            double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            double load = (ns / deadlineNs) * 100.0;
+            loads.push_back(load);
+
+            auto bucket = std::lower_bound(bucketEdges.begin(), bucketEdges.end(), load);
+            buckets[bucket - bucketEdges.begin()]++;
+        }
+
+        double mean = 0.0;
+        for (auto load : loads)
+        {
+            mean += load;
+        }
+        mean /= loads.size();
+
+        std::sort(loads.begin(), loads.end());
+        double p50 = loads[loads.size() / 2];
+        double p99 = loads[(loads.size() * 99) / 100];
+        double max = loads.back();
+        worstP99 = std::max(worstP99, p99);
+
+        fmt::print("  {:>6} {:>7.2f}ms {:>7.3f}% {:>7.3f}% {:>7.3f}% {:>7.3f}% |",
+            blockFrames, deadlineNs / 1e6, mean, p50, p99, max);
+        for (auto count : buckets)
+        {
+            fmt::print(" {:>6}", count);
+        }
+        fmt::print("\n");
+    }
+    fmt::print("\n");
+    return worstP99;
+}
+
+void bench_sampler(int voices)
+{
+    const int blockFrames = 512;
+    const int seconds = 30;
+    const int sampleFrames = benchSampleRate * 2;
+
+    ORCore::SamplerSource sampler({benchSampleRate, benchChannels}, voices, 2, voices * 2);
+
+    // One mono and one stereo sample long enough that every voice stays busy.
+    std::vector<float> mono(sampleFrames);
+    std::vector<float> stereo(sampleFrames * 2);
+    for (int i = 0; i < sampleFrames; ++i)
+    {
+        mono[i] = std::sin(i * 0.05f) * 0.01f;
+        stereo[i * 2] = mono[i];
+        stereo[(i * 2) + 1] = -mono[i];
+    }
+    int monoSample = sampler.add_sample(mono.data(), sampleFrames, {benchSampleRate, 1});
+    int stereoSample = sampler.add_sample(stereo.data(), sampleFrames, {benchSampleRate, 2});
+
+    auto data = ORCore::make_aligned_floats(blockFrames * benchChannels);
+    ORCore::Buffer buffer(data.get(), {benchChannels, blockFrames});
+
+    int callbacks = (seconds * benchSampleRate) / blockFrames;
+    int64_t nanoseconds = 0;
+    int peakVoices = 0;
+
+    for (int i = 0; i < callbacks; ++i)
+    {
+        // Keep the pool full, new triggers land at staggered offsets and steal the oldest voices.
+        if (i % 8 == 0)
+        {
+            for (int v = 0; v < voices / 4; ++v)
+            {
+                int64_t frame = sampler.get_frame_position() + ((v * 37) % blockFrames);
+                sampler.trigger(v % 2 ? monoSample : stereoSample, frame, 0.5f, ((v % 9) - 4) / 4.0f);
+            }
+        }
+
+        auto start = BenchClock::now();
+        sampler.pull(buffer);
+        auto end = BenchClock::now();
+
+        nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        peakVoices = std::max(peakVoices, sampler.get_active_voices());
+    }
+
+    double audioNs = (static_cast<double>(callbacks) * blockFrames * 1e9) / benchSampleRate;
+    fmt::print("Sampler, {} voice pool, {} peak voices, {} frame blocks\n", voices, peakVoices, blockFrames);
+    fmt::print("  {:<12} {:>10.2f} ns/frame, {:.3f}% of one core\n\n", "sampler",
+        nanoseconds / (static_cast<double>(callbacks) * blockFrames), (nanoseconds / audioNs) * 100.0);
+}
+
+// Returns the 99th percentile load of all players whammy stages in percent of the callback deadline.
+// guitarChannels is the layout of the guitar stems, the stages always output benchChannels.
+double bench_whammy(int players, int guitarChannels)
+{
+    const int blockFrames = 256;
+    const int seconds = 20;
+
+    std::vector<std::unique_ptr<SineStream>> guitars;
+    std::vector<std::unique_ptr<TimedStream>> timedGuitars;
+    std::vector<std::unique_ptr<ORCore::PitchShift>> whammys;
+    for (int i = 0; i < players; ++i)
+    {
+        guitars.push_back(std::make_unique<SineStream>(110 * (i + 1), benchSampleRate, guitarChannels));
+        timedGuitars.push_back(std::make_unique<TimedStream>());
+        timedGuitars.back()->add_source(guitars.back().get());
+        whammys.push_back(std::make_unique<ORCore::PitchShift>(benchChannels));
+        whammys.back()->add_source(timedGuitars.back().get());
+    }
+
+    auto data = ORCore::make_aligned_floats(blockFrames * benchChannels);
+    ORCore::Buffer buffer(data.get(), {benchChannels, blockFrames});
+
+    double deadlineNs = (blockFrames * 1e9) / benchSampleRate;
+    int callbacks = (seconds * benchSampleRate) / blockFrames;
+    std::vector<double> loads;
+    loads.reserve(callbacks);
+
+    for (int i = 0; i < callbacks; ++i)
+    {
+        // Every player works the bar continuously at a different rate, so each stage is always bending.
+        for (int p = 0; p < players; ++p)
+        {
+            whammys[p]->set_whammy(0.5f + (0.5f * std::sin(i * 0.01f * (p + 1))));
+            timedGuitars[p]->reset();
+        }
+
+        auto start = BenchClock::now();
+        for (auto &whammy : whammys)
+        {
+            whammy->pull(buffer);
+        }
+        auto end = BenchClock::now();
+
+        // Only the whammy stages count against the budget, not the sines feeding them.
+        double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        for (auto &timed : timedGuitars)
+        {
+            ns -= timed->get_nanoseconds();
+        }
+        loads.push_back((ns / deadlineNs) * 100.0);
+    }
+
+    std::sort(loads.begin(), loads.end());
+    double p50 = loads[loads.size() / 2];
+    double p99 = loads[(loads.size() * 99) / 100];
+
+    fmt::print("Whammy, {} players, {} channel guitars, {} frame blocks, {} frames of latency\n",
+        players, guitarChannels, blockFrames, whammys.front()->get_latency());
+    fmt::print("  {:<12} {:>7.3f}% p50 {:>7.3f}% p99 of the deadline, budget {:.3f}%\n\n",
+        "whammy", p50, p99, whammyBudget);
+    return p99;
+}
+
+// Returns the 99th percentile time of a pitch detection hop in milliseconds.
+double bench_pitch()
+{
+    const int seconds = 20;
+
+    SineStream voice(220, benchSampleRate);
+    ORCore::PitchDetector detector;
+    detector.add_source(&voice);
+
+    // Pull one hop at a time like a callback would, analysis is timed separately from the pull.
+    int hopFrames = detector.get_hop_frames();
+    auto data = ORCore::make_aligned_floats(hopFrames * benchChannels);
+    ORCore::Buffer buffer(data.get(), {benchChannels, hopFrames});
+
+    int hops = (seconds * benchSampleRate) / hopFrames;
+    std::vector<double> costs;
+    costs.reserve(hops);
+    std::vector<ORCore::PitchFrame> frames(64);
+    double frequency = 0.0;
+
+    for (int i = 0; i < hops; ++i)
+    {
+        detector.pull(buffer);
+
+        auto start = BenchClock::now();
+        int produced = detector.analyze();
+        auto end = BenchClock::now();
+
+        if (produced > 0)
+        {
+            double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            costs.push_back((ns / produced) / 1e6);
+        }
+
+        size_t count = detector.read_frames(frames.data(), frames.size());
+        if (count > 0)
+        {
+            frequency = frames[count - 1].frequency;
+        }
+    }
+
+    std::sort(costs.begin(), costs.end());
+    double p50 = costs[costs.size() / 2];
+    double p99 = costs[(costs.size() * 99) / 100];
+
+    fmt::print("Pitch detection, {} frame hops, 220Hz detected as {:.2f}Hz\n", hopFrames, frequency);
+    fmt::print("  {:<12} {:>7.3f}ms p50 {:>7.3f}ms p99 per hop, budget {:.3f}ms\n\n",
+        "yin", p50, p99, pitchHopBudget);
+    return p99;
+}
+
+int main(int argc, char* argv[])
+{
+    int sources = 8;
+    bool useStretch = true;
+    double maxLoad = 0.0;
+
+    if (argc > 1)
+    {
+        sources = std::stoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        useStretch = std::stoi(argv[2]) != 0;
+    }
+    if (argc > 3)
+    {
+        maxLoad = std::stod(argv[3]);
+    }
+
+    bench_stages(sources, useStretch);
+    bench_sampler(256);
+    double whammyP99 = std::max(bench_whammy(whammyPlayers, benchChannels), bench_whammy(whammyPlayers, 1));
+    double pitchP99 = bench_pitch();
+    double worstP99 = bench_callbacks(sources, useStretch);
+
+    if (maxLoad > 0.0 && worstP99 > maxLoad)
+    {
+        fmt::print("FAIL: p99 callback load {:.3f}% is over the limit of {:.3f}%\n", worstP99, maxLoad);
+        return 1;
+    }
+    if (whammyP99 > whammyBudget)
+    {
+        fmt::print("FAIL: p99 whammy load {:.3f}% is over the budget of {:.3f}%\n", whammyP99, whammyBudget);
+        return 1;
+    }
+    if (pitchP99 > pitchHopBudget)
+    {
+        fmt::print("FAIL: p99 pitch detection hop {:.3f}ms is over the budget of {:.3f}ms\n", pitchP99, pitchHopBudget);
+        return 1;
+    }
+    return 0;
+}
@@ -12,38 +12,7 @@
 #include "core/audio/cubeboutput.hpp"
 #include "core/audio/timestretch.hpp"
 
-class SineStream: public ORCore::ProducerStream 
-{ 
-public:
-    SineStream(int frequency)
-    :m_frequency(frequency)
-    {
-        set_pause(false);
-    }
-    ORCore::StreamFormat get_format() 
-    { 
-        return {44100, 2}; 
-    } 
-
-    void pull(ORCore::Buffer& buffer) 
-    { 
-        float *buf = buffer;
-        auto bufferInfo = buffer.get_info();
-        for (auto i = 0; i < bufferInfo.frames; i++) 
-        {
-            float sample = sin(2*3.14159265 * (i + m_framePosition) * m_frequency/44100) * 0.125;
-            for (auto c = 0; c < bufferInfo.channels; c++)
-            {
-                buf[(i*bufferInfo.channels)+c] = sample;
-            } 
-        } 
-        m_framePosition += buffer.get_info().frames; 
-    } 
-private:
-    int m_frequency;
-    int m_framePosition = 0; 
-
-}; 
+#include "teststreams.hpp"
 
 int main() {
 
@@ -76,7 +45,7 @@ int main() {
     ORCore::CubebOutput out;
     ORCore::TimeStretch timeStretch;
     timeStretch.add_source(&oggSource);
-    timeStretch.set_speed(1.0); // 200% speed
+    timeStretch.set_speed(1.0); // normal speed
 
     mix.add_source(&sine);
     mix.add_source(&sine2);
@@ -0,0 +1,48 @@
+// Copyright (c) 2015-2017 Matthew Sitton <matthewsitton@gmail.com>
+// See LICENSE in the project root for license information.
+
+#pragma once
+#include <cmath>
+
+#include "core/audio/streams.hpp"
+
+// Synthetic streams shared by the audio tests and benchmarks.
+
+class SineStream: public ORCore::ProducerStream
+{
+public:
+    SineStream(int frequency, int sampleRate = 44100, int channels = 2)
+    :m_frequency(frequency), m_sampleRate(sampleRate), m_channels(channels)
+    {
+        set_pause(false);
+        set_time(0.0);
+    }
+
+    ORCore::StreamFormat get_format()
+    {
+        return {m_sampleRate, m_channels};
+    }
+
+    void pull(ORCore::Buffer& buffer)
+    {
+        float *buf = buffer;
+        auto bufferInfo = buffer.get_info();
+        for (auto i = 0; i < bufferInfo.frames; i++)
+        {
+            float sample = sin(2*3.14159265 * (i + m_framePosition) * m_frequency/m_sampleRate) * 0.125;
+            for (auto c = 0; c < bufferInfo.channels; c++)
+            {
+                buf[(i*bufferInfo.channels)+c] = sample;
+            }
+        }
+        m_framePosition += buffer.get_info().frames;
+        set_time(m_framePosition / static_cast<double>(m_sampleRate));
+    }
+
+private:
+    int m_frequency;
+    int m_sampleRate;
+    int m_channels;
+    int64_t m_framePosition = 0;
+
+};